@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "async_io.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define ASYNC_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+struct AsyncFileIO::Request
+{
+    std::string path;
+    bool is_write = false;
+    int fd = -1;
+    std::vector<unsigned char> data;
+    size_t done = 0;
+    std::promise<std::vector<unsigned char>> read_result;
+    std::promise<bool> write_result;
+#if ASYNC_IO_URING
+    iovec iov;
+#endif
+};
+
+#if ASYNC_IO_URING
+// The shared submission/completion rings of one io_uring instance
+struct AsyncFileIO::Ring
+{
+    int fd = -1;
+    void *sq_ptr = MAP_FAILED, *cq_ptr = MAP_FAILED;
+    size_t sq_len = 0, cq_len = 0;
+    io_uring_sqe *sqes = (io_uring_sqe *)MAP_FAILED;
+    size_t sqes_len = 0;
+    unsigned *sq_tail = 0, *sq_mask = 0, *sq_array = 0;
+    unsigned *cq_head = 0, *cq_tail = 0, *cq_mask = 0;
+    io_uring_cqe *cqes = 0;
+
+    ~Ring()
+    {
+        if (sqes != MAP_FAILED)
+            munmap(sqes, sqes_len);
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+            munmap(cq_ptr, cq_len);
+        if (sq_ptr != MAP_FAILED)
+            munmap(sq_ptr, sq_len);
+        if (fd >= 0)
+            close(fd);
+    }
+
+    bool init(unsigned entries)
+    {
+        io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        fd = syscall(__NR_io_uring_setup, entries, &p);
+        if (fd < 0)
+            return false;
+
+        sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+#ifdef IORING_FEAT_SINGLE_MMAP
+        const bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+#else
+        const bool single = false;
+#endif
+        if (single)
+            sq_len = cq_len = std::max(sq_len, cq_len);
+        sq_ptr = mmap(0, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED)
+            return false;
+        cq_ptr = single ? sq_ptr : mmap(0, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED)
+            return false;
+        sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+        sqes = (io_uring_sqe *)mmap(0, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            return false;
+
+        char *sq = (char *)sq_ptr, *cq = (char *)cq_ptr;
+        sq_tail = (unsigned *)(sq + p.sq_off.tail);
+        sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+        sq_array = (unsigned *)(sq + p.sq_off.array);
+        cq_head = (unsigned *)(cq + p.cq_off.head);
+        cq_tail = (unsigned *)(cq + p.cq_off.tail);
+        cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+        cqes = (io_uring_cqe *)(cq + p.cq_off.cqes);
+        return true;
+    }
+
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+    }
+
+    // Queues and submits one entry. The kernel consumes it during the
+    // enter call, so the queue never fills up; if the call fails the entry
+    // is taken back (there is no other submitter, and no SQ polling).
+    bool push(uint8_t opcode, int file, const iovec *iov, uint64_t offset, void *user_data)
+    {
+        const unsigned tail = *sq_tail;
+        const unsigned idx = tail & *sq_mask;
+        io_uring_sqe *sqe = &sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = file;
+        sqe->off = offset;
+        sqe->addr = (uint64_t)(uintptr_t)iov;
+        sqe->len = iov ? 1 : 0;
+        sqe->user_data = (uint64_t)(uintptr_t)user_data;
+        sq_array[idx] = idx;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+        int ret;
+        do
+            ret = enter(1, 0, 0);
+        while (ret < 0 && (errno == EINTR || errno == EAGAIN));
+        if (ret != 1)
+            __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+        return ret == 1;
+    }
+};
+#else
+struct AsyncFileIO::Ring
+{
+};
+#endif
+
+AsyncFileIO::AsyncFileIO(int queue_depth, int threads)
+    : queue_depth(queue_depth)
+{
+#if ASYNC_IO_URING
+    ring.reset(new Ring);
+    if (ring->init(queue_depth))
+    {
+        reaper = std::thread(&AsyncFileIO::reap, this);
+        return;
+    }
+    ring.reset();
+#endif
+    for (int i = 0; i < threads; i++)
+        pool.emplace_back(&AsyncFileIO::run_pool, this);
+}
+
+AsyncFileIO::~AsyncFileIO()
+{
+    {
+        std::unique_lock<std::mutex> lock(sq_mutex);
+        slot_free.wait(lock, [&]() { return in_flight == 0; });
+    }
+#if ASYNC_IO_URING
+    if (ring)
+    {
+        // a NOP without request wakes the reaper up to exit
+        {
+            std::lock_guard<std::mutex> lock(sq_mutex);
+            ring->push(IORING_OP_NOP, -1, 0, 0, 0);
+        }
+        reaper.join();
+    }
+#endif
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        stopping = true;
+        pool_cv.notify_all();
+    }
+    for (auto &t : pool)
+        t.join();
+}
+
+std::future<std::vector<unsigned char>> AsyncFileIO::read(const std::string &path)
+{
+    Request *req = new Request;
+    req->path = path;
+    std::future<std::vector<unsigned char>> result = req->read_result.get_future();
+
+    struct stat st;
+    req->fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (req->fd < 0 || fstat(req->fd, &st) != 0)
+    {
+        if (req->fd >= 0)
+            close(req->fd);
+        req->read_result.set_value(std::vector<unsigned char>());
+        delete req;
+        return result;
+    }
+    req->data.resize(st.st_size);
+    submit(req);
+    return result;
+}
+
+std::future<bool> AsyncFileIO::write(const std::string &path, std::vector<unsigned char> data)
+{
+    Request *req = new Request;
+    req->path = path;
+    req->is_write = true;
+    req->data = std::move(data);
+    std::future<bool> result = req->write_result.get_future();
+
+    req->fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (req->fd < 0)
+    {
+        fprintf(stderr, "[ERROR] Cannot write %s: %s\n", path.c_str(), strerror(errno));
+        req->write_result.set_value(false);
+        delete req;
+        return result;
+    }
+    submit(req);
+    return result;
+}
+
+void AsyncFileIO::submit(Request *req)
+{
+    {
+        std::unique_lock<std::mutex> lock(sq_mutex);
+        slot_free.wait(lock, [&]() { return in_flight < queue_depth; });
+        in_flight++;
+        if (req->data.empty())
+        {
+            lock.unlock();
+            finish(req, true);
+            return;
+        }
+#if ASYNC_IO_URING
+        if (ring)
+        {
+            req->iov.iov_base = req->data.data();
+            req->iov.iov_len = req->data.size();
+            if (!ring->push(req->is_write ? IORING_OP_WRITEV : IORING_OP_READV, req->fd, &req->iov, 0, req))
+            {
+                lock.unlock();
+                finish(req, false);
+            }
+            return;
+        }
+#endif
+    }
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    tasks.push_back([this, req]() {
+        bool ok = true;
+        while (req->done < req->data.size())
+        {
+            unsigned char *p = req->data.data() + req->done;
+            const size_t left = req->data.size() - req->done;
+            ssize_t n = req->is_write ? pwrite(req->fd, p, left, req->done) : pread(req->fd, p, left, req->done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+            {
+                // a file that shrank since open() reads short, which is fine
+                ok = n == 0 && !req->is_write;
+                break;
+            }
+            req->done += n;
+        }
+        finish(req, ok);
+    });
+    pool_cv.notify_one();
+}
+
+void AsyncFileIO::finish(Request *req, bool ok)
+{
+    if (req->fd >= 0)
+        close(req->fd);
+    if (!ok)
+        fprintf(stderr, "[ERROR] I/O on %s failed\n", req->path.c_str());
+    if (req->is_write)
+    {
+        req->write_result.set_value(ok);
+    }
+    else
+    {
+        req->data.resize(ok ? req->done : 0);
+        req->read_result.set_value(std::move(req->data));
+    }
+    delete req;
+
+    std::lock_guard<std::mutex> lock(sq_mutex);
+    in_flight--;
+    slot_free.notify_all();
+}
+
+void AsyncFileIO::reap()
+{
+#if ASYNC_IO_URING
+    for (;;)
+    {
+        if (ring->enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+        {
+            fprintf(stderr, "[ERROR] io_uring wait failed: %s\n", strerror(errno));
+            break;
+        }
+
+        unsigned head = *ring->cq_head;
+        const unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        bool quit = false;
+        for (; head != tail; head++)
+        {
+            const io_uring_cqe &cqe = ring->cqes[head & *ring->cq_mask];
+            Request *req = (Request *)(uintptr_t)cqe.user_data;
+            const int res = cqe.res;
+            __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+            if (!req)
+            {
+                quit = true;
+                continue;
+            }
+
+            if (res > 0)
+                req->done += res;
+            const bool retry = res == -EAGAIN || res == -EINTR;
+            if (res < 0 && !retry)
+            {
+                finish(req, false);
+            }
+            else if (req->done == req->data.size() || (res == 0 && !req->is_write))
+            {
+                finish(req, true);
+            }
+            else if (res == 0)
+            {
+                finish(req, false);
+            }
+            else
+            {
+                // short transfer: queue the rest
+                std::unique_lock<std::mutex> lock(sq_mutex);
+                req->iov.iov_base = req->data.data() + req->done;
+                req->iov.iov_len = req->data.size() - req->done;
+                if (!ring->push(req->is_write ? IORING_OP_WRITEV : IORING_OP_READV, req->fd, &req->iov, req->done, req))
+                {
+                    lock.unlock();
+                    finish(req, false);
+                }
+            }
+        }
+        if (quit)
+            break;
+    }
+#endif
+}
+
+void AsyncFileIO::run_pool()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex);
+            pool_cv.wait(lock, [&]() { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Asynchronous whole-file reads and writes, so storage latency (SD cards,
+// network mounts) overlaps with inference instead of adding to it. Requests
+// go through one io_uring driven by raw syscalls (no liburing needed), with
+// a reaper thread completing them. Where io_uring is unavailable (old
+// kernel, disabled by seccomp or sysctl) a small thread pool issues plain
+// read()/write() calls instead. Opening files stays synchronous.
+class AsyncFileIO
+{
+public:
+    // queue_depth bounds the requests in flight (and the ring size),
+    // threads sizes the fallback pool
+    explicit AsyncFileIO(int queue_depth = 32, int threads = 2);
+    // waits for every queued request
+    ~AsyncFileIO();
+
+    const char *backend() const { return ring ? "io_uring" : "threads"; }
+
+    // whole file; an empty vector when it cannot be read
+    std::future<std::vector<unsigned char>> read(const std::string &path);
+    // creates or truncates path; false when it cannot be written
+    std::future<bool> write(const std::string &path, std::vector<unsigned char> data);
+
+private:
+    struct Ring;
+    struct Request;
+
+    void submit(Request *req);
+    void reap();
+    void finish(Request *req, bool ok);
+    void run_pool();
+
+    int queue_depth;
+
+    // io_uring path
+    std::unique_ptr<Ring> ring;
+    std::thread reaper;
+    std::mutex sq_mutex; // submissions come from callers and the reaper
+    std::condition_variable slot_free;
+    int in_flight = 0;
+
+    // fallback path
+    std::vector<std::thread> pool;
+    std::mutex pool_mutex;
+    std::condition_variable pool_cv;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+};
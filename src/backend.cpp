@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "backend.h"
+#include "fused_stem.h"
+#include "incremental.h"
+#include "weight_pack.h"
+#if NCNN_VULKAN
+#include "command.h"
+#include "gpu.h"
+#endif
+
+#if NCNN_VULKAN
+// GpuInfo::type(): 0 discrete, 1 integrated, 2 virtual, 3 cpu
+#define GPU_TYPE_CPU 3
+
+static const char *gpu_type_name(int type)
+{
+    static const char *names[] = {"discrete", "integrated", "virtual", "software"};
+    return type >= 0 && type <= GPU_TYPE_CPU ? names[type] : "unknown";
+}
+#endif
+
+int probe_vulkan_device(const std::string &device, const std::string &driver)
+{
+#if NCNN_VULKAN
+    // one instance per process, so the first probe decides the driver
+    static bool listed = false;
+    if (!listed)
+        ncnn::create_gpu_instance(driver.empty() ? 0 : driver.c_str());
+
+    int count = ncnn::get_gpu_count();
+    if (!listed)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            const ncnn::GpuInfo &info = ncnn::get_gpu_info(i);
+            printf("[VULKAN] device %d: %s (%s)\n", i, info.device_name(), gpu_type_name(info.type()));
+        }
+        listed = true;
+    }
+    if (count == 0)
+    {
+        printf("[WARN] No Vulkan device found\n");
+        return -1;
+    }
+
+    if (device == "software")
+    {
+        for (int i = 0; i < count; i++)
+            if (ncnn::get_gpu_info(i).type() == GPU_TYPE_CPU)
+                return i;
+        printf("[WARN] No software Vulkan device found\n");
+        return -1;
+    }
+    if (device == "auto")
+    {
+        // lavapipe and friends are far slower than ncnn's CPU kernels
+        int i = ncnn::get_default_gpu_index();
+        if (ncnn::get_gpu_info(i).type() == GPU_TYPE_CPU)
+        {
+            printf("[WARN] Only a software Vulkan device is available (%s), select it with --gpu=software\n", ncnn::get_gpu_info(i).device_name());
+            return -1;
+        }
+        return i;
+    }
+
+    char *end = 0;
+    long i = strtol(device.c_str(), &end, 10);
+    if (end == device.c_str() || *end != 0 || i < 0 || i >= count)
+    {
+        printf("[WARN] No Vulkan device %s (%d found)\n", device.c_str(), count);
+        return -1;
+    }
+    return (int)i;
+#else
+    (void)device;
+    (void)driver;
+    printf("[WARN] ncnn was built without Vulkan support\n");
+    return -1;
+#endif
+}
+
+void set_shader_cache_dir(const std::string &dir)
+{
+    // mkdir -p, the drivers only create their own subdirectory
+    for (size_t i = 1; i <= dir.size(); i++)
+        if (i == dir.size() || dir[i] == '/')
+            mkdir(dir.substr(0, i).c_str(), 0755);
+
+    setenv("MESA_SHADER_CACHE_DIR", dir.c_str(), 0);
+    setenv("__GL_SHADER_DISK_CACHE", "1", 0);
+    setenv("__GL_SHADER_DISK_CACHE_PATH", dir.c_str(), 0);
+    setenv("__GL_SHADER_DISK_CACHE_SKIP_CLEANUP", "1", 0);
+}
+
+NcnnBackend::NcnnBackend(const std::string &model_path, bool useVulkan, bool int8, int gpu_device, bool fp32)
+    : NcnnBackend(useVulkan, int8, gpu_device, model_path)
+{
+    if (fp32)
+    {
+        net.opt.use_bf16_storage = false;
+        net.opt.use_fp16_storage = false;
+        net.opt.use_fp16_packed = false;
+        net.opt.use_fp16_arithmetic = false;
+    }
+
+    const std::string packed_ext = ".ncnnz";
+    if (model_path.size() > packed_ext.size() && model_path.compare(model_path.size() - packed_ext.size(), packed_ext.size(), packed_ext) == 0)
+    {
+        if (!load_packed_model(net, model_path, packed_weights))
+            fprintf(stderr, "[ERROR] Failed to load %s\n", model_path.c_str());
+    }
+    else
+    {
+        net.load_param((model_path + ".param").c_str());
+        net.load_model((model_path + ".bin").c_str());
+    }
+
+#if NCNN_VULKAN
+    if (net.opt.use_vulkan_compute)
+        letterbox.reset(new VulkanLetterbox(net.vulkan_device(), net.opt));
+#endif
+}
+
+NcnnBackend::NcnnBackend(bool useVulkan, bool int8, int gpu_device, const std::string &model_path)
+{
+    if (useVulkan && gpu_device < 0)
+        gpu_device = probe_vulkan_device();
+    if (useVulkan && gpu_device < 0)
+    {
+        printf("[WARN] Vulkan unavailable, running %s on the CPU\n", model_path.c_str());
+        useVulkan = false;
+    }
+    net.opt.use_vulkan_compute = useVulkan; 
+#if NCNN_VULKAN
+    if (useVulkan)
+    {
+        net.set_vulkan_device(gpu_device);
+        device_name = ncnn::get_gpu_info(gpu_device).device_name();
+    }
+#endif
+
+    net.opt.use_bf16_storage = true; 
+    if(int8){
+        net.opt.use_int8_inference = true;
+        net.opt.use_fp16_arithmetic = false;
+    }else{
+        net.opt.use_int8_inference = false;
+        net.opt.use_fp16_arithmetic = true;
+    }      
+    net.opt.use_packing_layout = true;      
+    net.opt.num_threads = 3;
+}
+
+std::string NcnnBackend::describe() const
+{
+    char buf[256];
+    snprintf(buf, sizeof(buf), "backend=ncnn vulkan=%d bf16_storage=%d int8_inference=%d fp16_arithmetic=%d packing=%d threads=%d",
+             net.opt.use_vulkan_compute, net.opt.use_bf16_storage, net.opt.use_int8_inference, net.opt.use_fp16_arithmetic,
+             net.opt.use_packing_layout, net.opt.num_threads);
+    if (!device_name.empty())
+        return buf + (" device=\"" + device_name + "\"");
+    return buf;
+}
+
+int NcnnBackend::infer(const ncnn::Mat &in, std::vector<ncnn::Mat> &outs, int num_outputs)
+{
+    // extractors cache intermediate blobs, so each frame needs a fresh one
+    ncnn::Extractor ex = net.create_extractor();
+    ex.input("in0", in);
+
+    outs.resize(num_outputs);
+    for (int i = 0; i < num_outputs; i++)
+    {
+        std::string blob = "out" + std::to_string(i);
+        int ret = ex.extract(blob.c_str(), outs[i]);
+        if (ret != 0)
+            return ret;
+    }
+    return 0;
+}
+
+bool NcnnBackend::accepts_bgr() const
+{
+#if NCNN_VULKAN
+    return letterbox && letterbox->valid();
+#else
+    return false;
+#endif
+}
+
+int NcnnBackend::infer_bgr(const cv::Mat &bgr, const Letterbox &lb, std::vector<ncnn::Mat> &outs, int num_outputs)
+{
+#if NCNN_VULKAN
+    if (!accepts_bgr() || bgr.type() != CV_8UC3)
+        return -1;
+
+    const ncnn::VulkanDevice *vkdev = net.vulkan_device();
+    ncnn::VkAllocator *blob_vkallocator = vkdev->acquire_blob_allocator();
+    ncnn::VkAllocator *staging_vkallocator = vkdev->acquire_staging_allocator();
+    ncnn::Option opt = net.opt;
+    opt.blob_vkallocator = blob_vkallocator;
+    opt.workspace_vkallocator = blob_vkallocator;
+    opt.staging_vkallocator = staging_vkallocator;
+
+    int ret;
+    {
+        ncnn::Mat raw;
+        ncnn::VkMat upload, fp32, in_gpu;
+        ncnn::VkCompute cmd(vkdev);
+        letterbox->record(cmd, bgr, lb, raw, upload, fp32, in_gpu, opt);
+        ret = cmd.submit_and_wait();
+
+        // in0 stays on the device; extract() downloads and unpacks the outputs
+        ncnn::Extractor ex = net.create_extractor();
+        ex.set_blob_vkallocator(blob_vkallocator);
+        ex.set_workspace_vkallocator(blob_vkallocator);
+        ex.set_staging_vkallocator(staging_vkallocator);
+        if (ret == 0)
+            ex.input("in0", in_gpu);
+
+        outs.resize(num_outputs);
+        for (int i = 0; i < num_outputs && ret == 0; i++)
+        {
+            std::string blob = "out" + std::to_string(i);
+            ret = ex.extract(blob.c_str(), outs[i]);
+        }
+    }
+    // device buffers above are gone before their allocators are returned
+    vkdev->reclaim_blob_allocator(blob_vkallocator);
+    vkdev->reclaim_staging_allocator(staging_vkallocator);
+    return ret;
+#else
+    (void)bgr;
+    (void)lb;
+    (void)outs;
+    (void)num_outputs;
+    return -1;
+#endif
+}
+
+OpenCVDnnBackend::OpenCVDnnBackend(const std::string &model_path)
+{
+    net = cv::dnn::readNetFromONNX(model_path + ".onnx");
+    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    out_names = net.getUnconnectedOutLayersNames();
+    // ultralytics exports name them output0, output1
+    std::sort(out_names.begin(), out_names.end());
+}
+
+int OpenCVDnnBackend::infer(const ncnn::Mat &in, std::vector<ncnn::Mat> &outs, int num_outputs)
+{
+    if (net.empty() || (int)out_names.size() < num_outputs)
+        return -1;
+
+    // ncnn pads each channel to cstep, the NCHW blob is dense
+    const int shape[4] = {1, in.c, in.h, in.w};
+    blob.create(4, shape, CV_32F);
+    for (int q = 0; q < in.c; q++)
+        memcpy(blob.ptr<float>() + (size_t)q * in.w * in.h, (const float *)in.channel(q), in.w * in.h * sizeof(float));
+
+    net.setInput(blob);
+    std::vector<std::string> names(out_names.begin(), out_names.begin() + num_outputs);
+    net.forward(results, names);
+
+    outs.resize(num_outputs);
+    for (int i = 0; i < num_outputs; i++)
+    {
+        const cv::Mat &r = results[i];
+        if (r.dims == 3)
+        {
+            // [1, channels, anchors] maps directly onto a 2D ncnn::Mat
+            outs[i] = ncnn::Mat(r.size[2], r.size[1], (void *)r.ptr<float>());
+        }
+        else if (r.dims == 4)
+        {
+            // [1, c, h, w]: copy so every channel starts at ncnn's cstep
+            outs[i].create(r.size[3], r.size[2], r.size[1]);
+            for (int q = 0; q < r.size[1]; q++)
+                memcpy((float *)outs[i].channel(q), r.ptr<float>() + (size_t)q * r.size[2] * r.size[3], r.size[2] * r.size[3] * sizeof(float));
+        }
+        else
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+std::unique_ptr<InferenceBackend> create_backend(const std::string &kind, const std::string &model_path, bool useVulkan, bool int8, int gpu_device)
+{
+    if (kind == "ncnn")
+        return std::make_unique<NcnnBackend>(model_path, useVulkan, int8, gpu_device);
+    if (kind == "ncnn-incremental")
+        return std::make_unique<IncrementalNcnnBackend>(model_path, useVulkan, int8, gpu_device);
+    if (kind == "ncnn-fused-stem")
+        return std::make_unique<FusedStemNcnnBackend>(model_path, int8);
+    if (kind == "opencv")
+        return std::make_unique<OpenCVDnnBackend>(model_path);
+    return nullptr;
+}
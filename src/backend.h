@@ -0,0 +1,101 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "net.h"
+#include "gpu_preprocess.h"
+
+// Runs the network on an already letterboxed, normalized CHW input. Every
+// backend returns the head outputs in ncnn layout (out0 as channels x
+// anchors, out1 as prototypes) so decode and NMS are shared.
+class InferenceBackend
+{
+public:
+    virtual ~InferenceBackend() {}
+
+    virtual const char *name() const = 0;
+    // settings that affect speed, recorded with benchmark results
+    virtual std::string describe() const = 0;
+    virtual int infer(const ncnn::Mat &in, std::vector<ncnn::Mat> &outs, int num_outputs) = 0;
+
+    // Backends that can letterbox on their own device take the uint8 BGR
+    // frame instead; otherwise the caller preprocesses and calls infer().
+    virtual bool accepts_bgr() const { return false; }
+    virtual int infer_bgr(const cv::Mat &, const Letterbox &, std::vector<ncnn::Mat> &, int) { return -1; }
+    // whether infer_bgr() preprocesses on a GPU; YoloV11::gpu_preprocess
+    // switches only those off
+    virtual bool bgr_on_gpu() const { return false; }
+};
+
+// Picks the Vulkan device to run on. device is "auto" (ncnn's default GPU;
+// software implementations do not count), "software" (the first CPU-type
+// device, e.g. lavapipe or SwiftShader, for testing the Vulkan path on
+// machines without a GPU) or a device index. driver optionally names a
+// Vulkan driver library to load instead of the one the system loader picks.
+// Returns the device index, or -1 when the CPU path has to be used.
+int probe_vulkan_device(const std::string &device = "auto", const std::string &driver = "");
+
+// Moves the Vulkan driver's on-disk shader/pipeline cache to dir (Mesa:
+// v3dv, lavapipe, radv, anv; and NVIDIA), e.g. off a read-only or tmpfs
+// home. The drivers cache by default already; this only relocates it, and
+// ncnn's own GLSL->SPIR-V compile still runs on every start. Must run
+// before the first probe. Variables already set in the environment win.
+void set_shader_cache_dir(const std::string &dir);
+
+class NcnnBackend : public InferenceBackend
+{
+public:
+    // gpu_device < 0 probes the default device. Without a usable device the
+    // backend falls back to the CPU path and says so. A model_path ending in
+    // .ncnnz is loaded as a packed container. fp32 turns off bf16/fp16
+    // storage and fp16 arithmetic, for comparing models without their
+    // rounding.
+    NcnnBackend(const std::string &model_path, bool useVulkan = true, bool int8 = false, int gpu_device = -1, bool fp32 = false);
+
+    const char *name() const { return "ncnn"; }
+    std::string describe() const;
+    int infer(const ncnn::Mat &in, std::vector<ncnn::Mat> &outs, int num_outputs);
+
+    // with Vulkan active, resize/pad/normalize run in a compute shader
+    // and only the uint8 frame is uploaded
+    bool accepts_bgr() const;
+    int infer_bgr(const cv::Mat &bgr, const Letterbox &lb, std::vector<ncnn::Mat> &outs, int num_outputs);
+    bool bgr_on_gpu() const { return true; }
+
+protected:
+    friend class SplitNcnnBackend;
+
+    // device selection and options only, the subclass loads the model;
+    // model_path is for messages
+    NcnnBackend(bool useVulkan, bool int8, int gpu_device, const std::string &model_path);
+
+    ncnn::Net net;
+    std::string device_name; // Vulkan device in use, empty on the CPU path
+    std::vector<unsigned char> packed_weights; // referenced by net when loaded from .ncnnz
+#if NCNN_VULKAN
+    std::unique_ptr<VulkanLetterbox> letterbox;
+#endif
+};
+
+// OpenCV DNN on the equivalent ONNX export (<model_path>.onnx)
+class OpenCVDnnBackend : public InferenceBackend
+{
+public:
+    OpenCVDnnBackend(const std::string &model_path);
+
+    const char *name() const { return "opencv"; }
+    std::string describe() const { return "backend=opencv target=cpu"; }
+    int infer(const ncnn::Mat &in, std::vector<ncnn::Mat> &outs, int num_outputs);
+
+private:
+    cv::dnn::Net net;
+    std::vector<std::string> out_names;
+    cv::Mat blob;
+    std::vector<cv::Mat> results; // keeps wrapped output data alive
+};
+
+// kind is "ncnn", "ncnn-incremental", "ncnn-fused-stem" (CPU only) or "opencv";
+// returns null for anything else
+std::unique_ptr<InferenceBackend> create_backend(const std::string &kind, const std::string &model_path, bool useVulkan = true, bool int8 = false, int gpu_device = -1);
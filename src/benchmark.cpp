@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <math.h>
+#include <stdint.h>
+#include <thread>
+#include "benchmark.h"
+
+StageStats compute_stats(std::vector<double> samples)
+{
+    StageStats s;
+    if (samples.empty())
+        return s;
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double v : samples)
+        sum += v;
+    auto pct = [&](double p) { return samples[std::min(samples.size() - 1, (size_t)(p * samples.size()))]; };
+    s.mean = sum / samples.size();
+    s.p50 = pct(0.50);
+    s.p90 = pct(0.90);
+    s.p99 = pct(0.99);
+    s.min = samples.front();
+    s.max = samples.back();
+    return s;
+}
+
+std::vector<cv::Mat> load_images(const std::string &path)
+{
+    std::vector<cv::String> files;
+    cv::glob(path, files, false);
+    std::vector<cv::Mat> images;
+    for (const auto &f : files)
+    {
+        cv::Mat img = cv::imread(f);
+        if (!img.empty())
+            images.push_back(img);
+    }
+    return images;
+}
+
+BenchmarkResult run_benchmark(YoloV11 &yolo, const std::vector<cv::Mat> &images, int iterations, int warmup)
+{
+    BenchmarkResult r;
+    r.backend = yolo.backend_name();
+    r.config = yolo.backend_config();
+    r.objects.resize(images.size());
+
+    for (int it = -warmup; it < iterations; it++)
+    {
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            yolo.detect(images[i], r.objects[i]);
+            auto t1 = std::chrono::high_resolution_clock::now();
+            if (it == -warmup && i == 0)
+                r.first_frame_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+            if (it < 0)
+                continue;
+
+            const DetectTiming &t = yolo.last_timing();
+            r.preprocess.push_back(t.preprocess_ms);
+            r.inference.push_back(t.inference_ms);
+            r.postprocess.push_back(t.postprocess_ms + t.task_ms);
+            r.total.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+        }
+    }
+    return r;
+}
+
+static float iou(const cv::Rect_<float> &a, const cv::Rect_<float> &b)
+{
+    float inter = (a & b).area();
+    float uni = a.area() + b.area() - inter;
+    return uni > 0.f ? inter / uni : 0.f;
+}
+
+void print_comparison(const std::vector<BenchmarkResult> &results)
+{
+    printf("%-8s %-12s %9s %9s %9s %9s\n", "backend", "stage", "mean", "p50", "p90", "p99");
+    for (const auto &r : results)
+    {
+        const std::pair<const char *, const std::vector<double> *> stages[] = {
+            {"preprocess", &r.preprocess}, {"inference", &r.inference}, {"postprocess", &r.postprocess}, {"total", &r.total}};
+        for (const auto &st : stages)
+        {
+            StageStats s = compute_stats(*st.second);
+            printf("%-8s %-12s %9.2f %9.2f %9.2f %9.2f\n", r.backend.c_str(), st.first, s.mean, s.p50, s.p90, s.p99);
+        }
+        const double fps = r.total.empty() ? 0 : 1000.0 / compute_stats(r.total).mean;
+        printf("%-8s %-12s %9.1f fps\n", r.backend.c_str(), "throughput", fps);
+        printf("%-8s %-12s %9.1f ms load, %.1f ms first frame\n", r.backend.c_str(), "startup", r.load_ms, r.first_frame_ms);
+    }
+
+    if (results.size() < 2)
+        return;
+
+    const BenchmarkResult &ref = results[0];
+    for (size_t b = 1; b < results.size(); b++)
+    {
+        int ref_count = 0, cmp_count = 0, matched = 0;
+        double iou_sum = 0;
+        for (size_t i = 0; i < ref.objects.size() && i < results[b].objects.size(); i++)
+        {
+            const auto &a = ref.objects[i];
+            const auto &c = results[b].objects[i];
+            ref_count += a.size();
+            cmp_count += c.size();
+            std::vector<bool> used(c.size(), false);
+            for (const auto &oa : a)
+            {
+                int best = -1;
+                float best_iou = 0.5f;
+                for (size_t k = 0; k < c.size(); k++)
+                {
+                    float v = iou(oa.rect, c[k].rect);
+                    if (!used[k] && c[k].label == oa.label && v >= best_iou)
+                    {
+                        best = k;
+                        best_iou = v;
+                    }
+                }
+                if (best >= 0)
+                {
+                    used[best] = true;
+                    matched++;
+                    iou_sum += best_iou;
+                }
+            }
+        }
+        printf("[COMPARE] %s vs %s: %d/%d detections matched (%d found), mean IoU %.3f\n", results[b].backend.c_str(), ref.backend.c_str(),
+               matched, ref_count, cmp_count, matched ? iou_sum / matched : 0.0);
+    }
+}
+
+static std::string read_first_line(const std::string &path)
+{
+    std::ifstream f(path);
+    std::string line;
+    std::getline(f, line);
+    return line;
+}
+
+BenchmarkEnvironment probe_environment(const std::string &model_path)
+{
+    BenchmarkEnvironment env;
+
+    // x86 reports "model name", the Pi's kernel "Model" (board) or "Hardware"
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    for (std::string line; std::getline(cpuinfo, line);)
+    {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos)
+            continue;
+        std::string key = line.substr(0, line.find_last_not_of(" \t", colon - 1) + 1);
+        size_t value = line.find_first_not_of(" \t", colon + 1);
+        if (value == std::string::npos)
+            continue;
+        if (key == "model name" || key == "Model" || (key == "Hardware" && env.cpu_model.empty()))
+            env.cpu_model = line.substr(value);
+    }
+    env.cores = std::thread::hardware_concurrency();
+    env.governor = read_first_line("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor");
+
+    uint64_t hash = 1469598103934665603ULL;
+    const char *exts[] = {".param", ".bin", ".onnx", ""}; // "" = packed .ncnnz path
+    for (const char *ext : exts)
+    {
+        std::ifstream f(model_path + ext, std::ios::binary);
+        char buf[65536];
+        while (f.read(buf, sizeof(buf)) || f.gcount() > 0)
+        {
+            for (std::streamsize i = 0; i < f.gcount(); i++)
+            {
+                hash ^= (unsigned char)buf[i];
+                hash *= 1099511628211ULL;
+            }
+        }
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+    env.model_hash = hex;
+
+#if defined(__clang__)
+    env.build = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    env.build = "gcc " __VERSION__;
+#endif
+#ifdef NDEBUG
+    env.build += " release";
+#endif
+    return env;
+}
+
+bool save_benchmark(const std::string &path, const BenchmarkEnvironment &env, const std::vector<BenchmarkResult> &results)
+{
+    cv::FileStorage fs(path, cv::FileStorage::WRITE | cv::FileStorage::FORMAT_JSON);
+    if (!fs.isOpened())
+        return false;
+
+    fs << "environment" << "{";
+    fs << "cpu_model" << env.cpu_model << "cores" << env.cores << "governor" << env.governor;
+    fs << "model_hash" << env.model_hash << "build" << env.build;
+    fs << "}";
+
+    fs << "runs" << "[";
+    for (const auto &r : results)
+    {
+        fs << "{";
+        fs << "backend" << r.backend << "config" << r.config;
+        fs << "load_ms" << r.load_ms << "first_frame_ms" << r.first_frame_ms;
+        fs << "preprocess" << r.preprocess << "inference" << r.inference;
+        fs << "postprocess" << r.postprocess << "total" << r.total;
+        fs << "}";
+    }
+    fs << "]";
+    return true;
+}
+
+bool load_benchmark(const std::string &path, BenchmarkEnvironment &env, std::vector<BenchmarkResult> &results)
+{
+    cv::FileStorage fs(path, cv::FileStorage::READ | cv::FileStorage::FORMAT_JSON);
+    if (!fs.isOpened())
+        return false;
+
+    cv::FileNode e = fs["environment"];
+    e["cpu_model"] >> env.cpu_model;
+    e["cores"] >> env.cores;
+    e["governor"] >> env.governor;
+    e["model_hash"] >> env.model_hash;
+    e["build"] >> env.build;
+
+    results.clear();
+    cv::FileNode runs = fs["runs"];
+    for (auto it = runs.begin(); it != runs.end(); ++it)
+    {
+        cv::FileNode n = *it;
+        BenchmarkResult r;
+        n["backend"] >> r.backend;
+        n["config"] >> r.config;
+        n["load_ms"] >> r.load_ms;
+        n["first_frame_ms"] >> r.first_frame_ms;
+        n["preprocess"] >> r.preprocess;
+        n["inference"] >> r.inference;
+        n["postprocess"] >> r.postprocess;
+        n["total"] >> r.total;
+        results.push_back(r);
+    }
+    return true;
+}
+
+// two-sided 95% critical value of Student's t for df degrees of freedom
+static double t_critical_95(double df)
+{
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df < 1)
+        return table[0];
+    if (df <= 30)
+        return table[(int)df - 1];
+    return 1.96 + 2.4 / df;
+}
+
+static void mean_var(const std::vector<double> &v, double &mean, double &var)
+{
+    mean = 0;
+    for (double x : v)
+        mean += x;
+    mean /= v.size();
+    var = 0;
+    for (double x : v)
+        var += (x - mean) * (x - mean);
+    var = v.size() > 1 ? var / (v.size() - 1) : 0;
+}
+
+static void warn_if_differs(const char *what, const std::string &a, const std::string &b)
+{
+    if (a != b)
+        printf("[WARN] %s differs: '%s' vs '%s'\n", what, a.c_str(), b.c_str());
+}
+
+int compare_benchmarks(const std::string &base_path, const std::string &new_path, double threshold_pct)
+{
+    BenchmarkEnvironment base_env, new_env;
+    std::vector<BenchmarkResult> base_runs, new_runs;
+    if (!load_benchmark(base_path, base_env, base_runs) || !load_benchmark(new_path, new_env, new_runs))
+    {
+        fprintf(stderr, "Failed to read benchmark results\n");
+        return -1;
+    }
+
+    warn_if_differs("cpu model", base_env.cpu_model, new_env.cpu_model);
+    warn_if_differs("core count", std::to_string(base_env.cores), std::to_string(new_env.cores));
+    warn_if_differs("governor", base_env.governor, new_env.governor);
+    warn_if_differs("model hash", base_env.model_hash, new_env.model_hash);
+    warn_if_differs("build", base_env.build, new_env.build);
+
+    int regressions = 0;
+    printf("%-8s %-12s %10s %10s %9s %22s  %s\n", "backend", "stage", "base ms", "new ms", "delta", "95% CI of delta (ms)", "verdict");
+    for (const auto &b : base_runs)
+    {
+        auto n = std::find_if(new_runs.begin(), new_runs.end(), [&](const BenchmarkResult &r) { return r.backend == b.backend; });
+        if (n == new_runs.end())
+            continue;
+        warn_if_differs("backend config", b.config, n->config);
+        // single samples, shown for reference only
+        printf("%-8s %-12s %10.2f %10.2f\n", b.backend.c_str(), "load", b.load_ms, n->load_ms);
+
+        const std::pair<const char *, std::pair<const std::vector<double> *, const std::vector<double> *>> stages[] = {
+            {"preprocess", {&b.preprocess, &n->preprocess}},
+            {"inference", {&b.inference, &n->inference}},
+            {"postprocess", {&b.postprocess, &n->postprocess}},
+            {"total", {&b.total, &n->total}}};
+        for (const auto &st : stages)
+        {
+            const std::vector<double> &x = *st.second.first, &y = *st.second.second;
+            if (x.size() < 2 || y.size() < 2)
+                continue;
+
+            // Welch's t interval: no equal-variance assumption between runs
+            double mx, vx, my, vy;
+            mean_var(x, mx, vx);
+            mean_var(y, my, vy);
+            const double sx = vx / x.size(), sy = vy / y.size();
+            const double se = sqrt(sx + sy);
+            const double df = se > 0 ? (sx + sy) * (sx + sy) / (sx * sx / (x.size() - 1) + sy * sy / (y.size() - 1)) : 1e9;
+            const double diff = my - mx;
+            const double half = t_critical_95(df) * se;
+            const double pct = mx > 0 ? 100.0 * diff / mx : 0;
+
+            const char *verdict = "same";
+            if (diff - half > 0 && pct > threshold_pct)
+            {
+                verdict = "REGRESSION";
+                regressions++;
+            }
+            else if (diff + half < 0 && -pct > threshold_pct)
+            {
+                verdict = "improved";
+            }
+            printf("%-8s %-12s %10.2f %10.2f %+8.1f%% [%+9.2f, %+9.2f]  %s\n", b.backend.c_str(), st.first, mx, my, pct, diff - half, diff + half, verdict);
+        }
+    }
+    return regressions;
+}
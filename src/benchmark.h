@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "object.h"
+#include "yolo11.h"
+
+struct StageStats
+{
+    double mean = 0, p50 = 0, p90 = 0, p99 = 0, min = 0, max = 0;
+};
+
+StageStats compute_stats(std::vector<double> samples);
+
+// What a result was measured on; results are only comparable when these
+// match (the compare tool warns otherwise).
+struct BenchmarkEnvironment
+{
+    std::string cpu_model;
+    int cores = 0;
+    std::string governor;
+    std::string model_hash; // FNV-1a 64 of the model files
+    std::string build;      // compiler and build type
+};
+
+BenchmarkEnvironment probe_environment(const std::string &model_path);
+
+struct BenchmarkResult
+{
+    std::string backend;
+    std::string config; // backend options, e.g. ncnn net.opt flags
+    double load_ms = 0;        // backend construction (model load, pipeline creation)
+    double first_frame_ms = 0; // first detect(), includes lazy allocations
+    std::vector<double> preprocess, inference, postprocess, total; // ms per frame
+    std::vector<std::vector<Object>> objects;                     // last pass, per image
+};
+
+// imagepath may be a single file or a directory
+std::vector<cv::Mat> load_images(const std::string &path);
+
+// Runs detect() over all images `iterations` times after `warmup` passes
+// and records per-stage timings.
+BenchmarkResult run_benchmark(YoloV11 &yolo, const std::vector<cv::Mat> &images, int iterations, int warmup = 3);
+
+// Side-by-side timing table; detections of every backend are matched
+// against the first one (same label, IoU >= 0.5).
+void print_comparison(const std::vector<BenchmarkResult> &results);
+
+// JSON via cv::FileStorage, raw samples included so later comparisons can
+// compute confidence intervals
+bool save_benchmark(const std::string &path, const BenchmarkEnvironment &env, const std::vector<BenchmarkResult> &results);
+bool load_benchmark(const std::string &path, BenchmarkEnvironment &env, std::vector<BenchmarkResult> &results);
+
+// Compares runs of the same backend in two result files stage by stage.
+// A stage regresses when the 95% confidence interval of the mean
+// difference lies above zero and the slowdown exceeds threshold_pct.
+// Returns the number of regressions.
+int compare_benchmarks(const std::string &base_path, const std::string &new_path, double threshold_pct = 2.0);
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <chrono>
+#include "delta_stream.h"
+#include "trace.h"
+
+static float iou(const cv::Rect_<float> &a, const cv::Rect_<float> &b)
+{
+    float inter = (a & b).area();
+    float uni = a.area() + b.area() - inter;
+    return uni > 0.f ? inter / uni : 0.f;
+}
+
+static void put_u16(std::string &out, uint16_t v)
+{
+    out += (char)(v & 0xff);
+    out += (char)(v >> 8);
+}
+
+static void put_u32(std::string &out, uint32_t v)
+{
+    put_u16(out, v & 0xffff);
+    put_u16(out, v >> 16);
+}
+
+static void put_u64(std::string &out, uint64_t v)
+{
+    put_u32(out, v & 0xffffffff);
+    put_u32(out, v >> 32);
+}
+
+static uint16_t to_u16(float v)
+{
+    return (uint16_t)std::min(std::max(v + 0.5f, 0.f), 65535.f);
+}
+
+DeltaEncoder::DeltaEncoder(const DeltaOptions &opt)
+    : opt(opt)
+{
+}
+
+int DeltaEncoder::encode(int64_t time_us, const std::vector<Object> &objects, std::string &out)
+{
+    const bool key = frame == 0 || (opt.keyframe_interval > 0 && frame % opt.keyframe_interval == 0);
+    frame++;
+
+    // continue known objects, each with its best unused match
+    std::vector<std::pair<Kind, Track>> events;
+    std::vector<bool> used(objects.size(), false);
+    for (auto &t : tracks)
+    {
+        int best = -1;
+        float best_iou = opt.match_iou;
+        for (size_t k = 0; k < objects.size(); k++)
+        {
+            if (used[k] || objects[k].label != t.label)
+                continue;
+            float v = iou(t.rect, objects[k].rect);
+            if (v >= best_iou)
+            {
+                best = k;
+                best_iou = v;
+            }
+        }
+        if (best < 0)
+        {
+            t.missed++;
+            continue;
+        }
+        used[best] = true;
+        t.rect = objects[best].rect;
+        t.prob = objects[best].prob;
+        t.missed = 0;
+        if (iou(t.rect, t.reported) < opt.move_iou)
+        {
+            t.reported = t.rect;
+            events.push_back({MOVE, t});
+        }
+    }
+
+    // a single missed frame is usually detector flicker
+    const int hold = std::max(opt.hold_frames, 1);
+    for (size_t i = 0; i < tracks.size();)
+    {
+        if (tracks[i].missed >= hold)
+        {
+            events.push_back({GONE, tracks[i]});
+            tracks.erase(tracks.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    for (size_t k = 0; k < objects.size(); k++)
+    {
+        if (used[k])
+            continue;
+        tracks.push_back(Track{next_id++, objects[k].label, objects[k].prob, objects[k].rect, objects[k].rect, 0});
+        events.push_back({APPEAR, tracks.back()});
+    }
+
+    if (key)
+    {
+        begin_record(true, time_us, out);
+        for (auto &t : tracks)
+        {
+            t.reported = t.rect;
+            append_entry(KEY, t, out);
+        }
+        end_record(out);
+        return tracks.size();
+    }
+    if (events.empty())
+        return 0;
+    begin_record(false, time_us, out);
+    for (const auto &e : events)
+        append_entry(e.first, e.second, out);
+    end_record(out);
+    return events.size();
+}
+
+size_t DeltaEncoder::full_bytes(int64_t time_us, const std::vector<Object> &objects)
+{
+    std::string s;
+    begin_record(true, time_us, s);
+    for (const auto &obj : objects)
+        append_entry(KEY, Track{0, obj.label, obj.prob, obj.rect, obj.rect, 0}, s);
+    end_record(s);
+    return s.size();
+}
+
+void DeltaEncoder::begin_record(bool key, int64_t time_us, std::string &out)
+{
+    record_start = out.size();
+    record_count = 0;
+    if (opt.binary)
+    {
+        out += key ? 'K' : 'D';
+        out += (char)0;
+        put_u16(out, 0); // count, see end_record()
+        put_u32(out, frame - 1);
+        put_u64(out, (uint64_t)time_us);
+        return;
+    }
+    char buf[96];
+    snprintf(buf, sizeof(buf), "{\"t\":%lld,\"frame\":%d,\"%s\":[", (long long)time_us, frame - 1, key ? "key" : "events");
+    out += buf;
+}
+
+void DeltaEncoder::append_entry(Kind kind, const Track &t, std::string &out)
+{
+    record_count++;
+    if (opt.binary)
+    {
+        out += (char)kind;
+        out += (char)std::min(std::max(t.label, 0), 255);
+        put_u16(out, to_u16(t.prob * 65535.f));
+        put_u32(out, t.id);
+        put_u16(out, to_u16(t.rect.x));
+        put_u16(out, to_u16(t.rect.y));
+        put_u16(out, to_u16(t.rect.width));
+        put_u16(out, to_u16(t.rect.height));
+        return;
+    }
+
+    char buf[192];
+    const char *sep = record_count > 1 ? "," : "";
+    if (kind == GONE)
+        snprintf(buf, sizeof(buf), "%s{\"e\":\"gone\",\"id\":%u}", sep, t.id);
+    else if (kind == MOVE)
+        snprintf(buf, sizeof(buf), "%s{\"e\":\"move\",\"id\":%u,\"box\":[%.1f,%.1f,%.1f,%.1f]}", sep, t.id, t.rect.x, t.rect.y, t.rect.width,
+                 t.rect.height);
+    else
+        snprintf(buf, sizeof(buf), "%s{%s\"id\":%u,\"label\":%d,\"score\":%.3f,\"box\":[%.1f,%.1f,%.1f,%.1f]}", sep,
+                 kind == APPEAR ? "\"e\":\"appear\"," : "", t.id, t.label, t.prob, t.rect.x, t.rect.y, t.rect.width, t.rect.height);
+    out += buf;
+}
+
+void DeltaEncoder::end_record(std::string &out)
+{
+    if (opt.binary)
+    {
+        out[record_start + 2] = (char)(record_count & 0xff);
+        out[record_start + 3] = (char)(record_count >> 8);
+        return;
+    }
+    out += "]}\n";
+}
+
+int run_delta_stream(YoloV11 &yolo, const std::string &source, const std::string &out_path, const DeltaOptions &opt, int max_frames)
+{
+    // a trace directory of JPEGs is read as is, one referencing a video
+    // plays that video
+    Trace trace;
+    const bool from_trace = load_trace(source, trace) && trace.video.empty();
+    cv::VideoCapture cap;
+    if (!from_trace && !open_source(cap, trace.video.empty() ? source : trace.video))
+    {
+        fprintf(stderr, "Failed to open source: %s\n", source.c_str());
+        return -1;
+    }
+    FILE *out = out_path == "-" ? stdout : fopen(out_path.c_str(), opt.binary ? "wb" : "w");
+    if (!out)
+    {
+        fprintf(stderr, "Cannot open %s\n", out_path.c_str());
+        return -1;
+    }
+    // keep the stream itself clean on stdout
+    FILE *log = out == stdout ? stderr : stdout;
+
+    DeltaEncoder encoder(opt);
+    std::string record;
+    std::vector<Object> objects;
+    cv::Mat img;
+    int frames = 0, records = 0;
+    long long entries = 0, bytes = 0, full = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; max_frames <= 0 || frames < max_frames; i++)
+    {
+        int64_t time_us;
+        if (from_trace)
+        {
+            if (i >= trace.frames.size())
+                break;
+            img = cv::imread(trace.dir + "/" + trace.frames[i].file);
+            time_us = trace.frames[i].arrival_us;
+        }
+        else
+        {
+            if (!cap.read(img))
+                break;
+            time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+        if (img.empty())
+            continue;
+
+        yolo.detect(img, objects);
+        full += encoder.full_bytes(time_us, objects);
+        record.clear();
+        entries += encoder.encode(time_us, objects, record);
+        frames++;
+        if (record.empty())
+            continue;
+        fwrite(record.data(), 1, record.size(), out);
+        fflush(out);
+        bytes += record.size();
+        records++;
+    }
+    if (out != stdout)
+        fclose(out);
+
+    fprintf(log, "[DELTA] %d frames, %d records with %lld entries, %lld bytes (%.1f per frame), %lld bytes as full frames (%.1fx)\n",
+            frames, records, entries, bytes, frames ? (double)bytes / frames : 0.0, full, bytes ? (double)full / bytes : 0.0);
+    return 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "yolo11.h"
+
+struct DeltaOptions
+{
+    bool binary = false;
+    float match_iou = 0.3f;      // same label and at least this IoU continue an object from the last frame
+    float move_iou = 0.7f;       // a move is reported once the IoU with the last reported box drops below this
+    int hold_frames = 3;         // consecutive misses before an object is reported gone
+    int keyframe_interval = 150; // frames between full snapshots, 0 = only the first frame
+};
+
+// Turns per-frame detections into a stream of changes. Objects are followed
+// from frame to frame by IoU (greedy, same label) and get an id when they
+// first appear; a frame produces a record only when one of them appears,
+// moves beyond move_iou or stays missing for hold_frames frames. Every
+// keyframe_interval frames a keyframe lists all live objects instead, so a
+// consumer that joins late or lost records can resync.
+//
+// JSON: one line per record,
+//   {"t":<us>,"frame":N,"key":[{"id":1,"label":0,"score":0.91,"box":[x,y,w,h]},...]}
+//   {"t":<us>,"frame":N,"events":[{"e":"appear","id":..,"label":..,"score":..,"box":[..]},
+//                                 {"e":"move","id":..,"box":[..]},{"e":"gone","id":..}]}
+// Binary, little endian: a 16 byte header (u8 'K' or 'D', u8 0, u16 count,
+// u32 frame, i64 time_us) followed by count 16 byte entries (u8 kind
+// 0 key / 1 appear / 2 move / 3 gone, u8 label, u16 score * 65535, u32 id,
+// u16 x, y, w, h in pixels).
+class DeltaEncoder
+{
+public:
+    explicit DeltaEncoder(const DeltaOptions &opt);
+
+    // Appends the frame's record to out (nothing when nothing changed) and
+    // returns the number of events, or of objects for a keyframe.
+    int encode(int64_t time_us, const std::vector<Object> &objects, std::string &out);
+
+    // size of a keyframe listing every detection of a frame, what sending
+    // each frame in full would cost
+    size_t full_bytes(int64_t time_us, const std::vector<Object> &objects);
+
+private:
+    enum Kind
+    {
+        KEY = 0,
+        APPEAR = 1,
+        MOVE = 2,
+        GONE = 3
+    };
+    struct Track
+    {
+        uint32_t id;
+        int label;
+        float prob;
+        cv::Rect_<float> rect, reported;
+        int missed;
+    };
+
+    void begin_record(bool key, int64_t time_us, std::string &out);
+    void append_entry(Kind kind, const Track &t, std::string &out);
+    void end_record(std::string &out);
+
+    DeltaOptions opt;
+    std::vector<Track> tracks;
+    uint32_t next_id = 1;
+    int frame = 0;
+
+    // record being written
+    size_t record_start = 0;
+    int record_count = 0;
+};
+
+// Runs the detector over every frame of source (camera index, device,
+// stream URL, video file or trace directory) and writes the delta stream to
+// out_path (- = stdout).
+int run_delta_stream(YoloV11 &yolo, const std::string &source, const std::string &out_path, const DeltaOptions &opt, int max_frames = 0);
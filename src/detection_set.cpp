@@ -0,0 +1,91 @@
+#include <algorithm>
+#include "detection_set.h"
+
+void DetectionSet::reserve(int capacity)
+{
+    if (capacity <= cap)
+        return;
+    cap = capacity;
+    px0.resize(cap);
+    py0.resize(cap);
+    px1.resize(cap);
+    py1.resize(cap);
+    pscore.resize(cap);
+    plabel.resize(cap);
+    panchor.resize(cap);
+    order.reserve(cap);
+    ftmp.resize(cap);
+    itmp.resize(cap);
+}
+
+void DetectionSet::gather(const int *indices, int n)
+{
+    auto gather_f = [&](std::vector<float> &v) {
+        for (int i = 0; i < n; i++)
+            ftmp[i] = v[indices[i]];
+        std::copy(ftmp.begin(), ftmp.begin() + n, v.begin());
+    };
+    auto gather_i = [&](std::vector<int> &v) {
+        for (int i = 0; i < n; i++)
+            itmp[i] = v[indices[i]];
+        std::copy(itmp.begin(), itmp.begin() + n, v.begin());
+    };
+    gather_f(px0);
+    gather_f(py0);
+    gather_f(px1);
+    gather_f(py1);
+    gather_f(pscore);
+    gather_i(plabel);
+    gather_i(panchor);
+    count = n;
+}
+
+void DetectionSet::sort_descending()
+{
+    order.resize(count);
+    for (int i = 0; i < count; i++)
+        order[i] = i;
+    const float *s = pscore.data();
+    std::sort(order.begin(), order.end(), [s](int a, int b) { return s[a] > s[b]; });
+    gather(order.data(), count);
+}
+
+void DetectionSet::select(const std::vector<int> &indices)
+{
+    gather(indices.data(), indices.size());
+}
+
+void DetectionSet::remap(float dx, float dy, float scale, int img_w, int img_h)
+{
+    remap(dx, dy, scale, scale, img_w, img_h);
+}
+
+void DetectionSet::remap(float dx, float dy, float scale_x, float scale_y, int img_w, int img_h)
+{
+    const float inv_x = 1.f / scale_x, inv_y = 1.f / scale_y;
+    const float max_x = img_w - 1.f, max_y = img_h - 1.f;
+    for (int i = 0; i < count; i++)
+    {
+        px0[i] = std::max(0.f, std::min(max_x, (px0[i] - dx) * inv_x));
+        px1[i] = std::max(0.f, std::min(max_x, (px1[i] - dx) * inv_x));
+    }
+    for (int i = 0; i < count; i++)
+    {
+        py0[i] = std::max(0.f, std::min(max_y, (py0[i] - dy) * inv_y));
+        py1[i] = std::max(0.f, std::min(max_y, (py1[i] - dy) * inv_y));
+    }
+}
+
+void DetectionSet::to_objects(std::vector<Object> &objects) const
+{
+    objects.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        Object &obj = objects[i];
+        obj = Object();
+        obj.rect = cv::Rect_<float>(px0[i], py0[i], px1[i] - px0[i], py1[i] - py0[i]);
+        obj.label = plabel[i];
+        obj.prob = pscore[i];
+        obj.anchor = panchor[i];
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include "object.h"
+
+// Structure-of-arrays detection container used by decode, sort, NMS and
+// remap. Storage is allocated once for a fixed capacity (one slot per head
+// anchor) and reused frame after frame; clear() only resets the count.
+class DetectionSet
+{
+public:
+    // by-value view of one detection, for consumers that want a record
+    struct Detection
+    {
+        float x0, y0, x1, y1;
+        float score;
+        int label;
+        int anchor;
+    };
+
+    explicit DetectionSet(int capacity = 0) { reserve(capacity); }
+
+    // grows storage to at least capacity, never shrinks
+    void reserve(int capacity);
+    void clear() { count = 0; }
+
+    int size() const { return count; }
+    int capacity() const { return cap; }
+    bool empty() const { return count == 0; }
+
+    // returns the new index, or -1 when full
+    int push(float x0, float y0, float x1, float y1, float score, int label, int anchor)
+    {
+        if (count >= cap)
+            return -1;
+        const int i = count++;
+        px0[i] = x0;
+        py0[i] = y0;
+        px1[i] = x1;
+        py1[i] = y1;
+        pscore[i] = score;
+        plabel[i] = label;
+        panchor[i] = anchor;
+        return i;
+    }
+
+    Detection operator[](int i) const { return {px0[i], py0[i], px1[i], py1[i], pscore[i], plabel[i], panchor[i]}; }
+
+    float *x0() { return px0.data(); }
+    float *y0() { return py0.data(); }
+    float *x1() { return px1.data(); }
+    float *y1() { return py1.data(); }
+    float *score() { return pscore.data(); }
+    int *label() { return plabel.data(); }
+    int *anchor() { return panchor.data(); }
+    const float *x0() const { return px0.data(); }
+    const float *y0() const { return py0.data(); }
+    const float *x1() const { return px1.data(); }
+    const float *y1() const { return py1.data(); }
+    const float *score() const { return pscore.data(); }
+    const int *label() const { return plabel.data(); }
+    const int *anchor() const { return panchor.data(); }
+
+    // reorders by descending score
+    void sort_descending();
+    // keeps only the listed indices, in that order
+    void select(const std::vector<int> &indices);
+    // maps letterboxed input coordinates back to the source image
+    void remap(float dx, float dy, float scale, int img_w, int img_h);
+    // same with separate x and y scales, e.g. for a resize that rounded
+    // each side on its own
+    void remap(float dx, float dy, float scale_x, float scale_y, int img_w, int img_h);
+
+    void to_objects(std::vector<Object> &objects) const;
+
+private:
+    void gather(const int *indices, int n);
+
+    int count = 0;
+    int cap = 0;
+    std::vector<float> px0, py0, px1, py1, pscore;
+    std::vector<int> plabel, panchor;
+
+    // scratch reused by sort/select
+    std::vector<int> order;
+    std::vector<float> ftmp;
+    std::vector<int> itmp;
+};
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+#include "benchmark.h"
+#include "downscale.h"
+
+int box_factor(int src_w, int src_h, int w, int h)
+{
+    if (w <= 0 || h <= 0)
+        return 0;
+    const int k = std::min(src_w / w, src_h / h);
+    // uint16 row sums hold at most k * 255; factors above 16 use bilinear
+    if (k < 2 || k > 16)
+        return 0;
+    if (src_w - k * w > src_w / 100 || src_h - k * h > src_h / 100)
+        return 0;
+    return k;
+}
+
+// Row sums of K source rows, then sums of K adjacent pixels per channel.
+// K as a template parameter lets the compiler unroll and vectorize both
+// loops for the common factors.
+template <int K>
+static void box_downscale(const cv::Mat &bgr, int k, int x0, int y0, ncnn::Mat &out, int num_threads)
+{
+    if (K > 0)
+        k = K;
+    const int w = out.w, h = out.h;
+    const int row_len = k * w * 3;
+    const float inv = 1.f / (k * k);
+
+#pragma omp parallel num_threads(num_threads)
+    {
+        std::vector<uint16_t> sums(row_len);
+
+#pragma omp for
+        for (int y = 0; y < h; y++)
+        {
+            const unsigned char *s = bgr.ptr(y0 + y * k) + x0 * 3;
+            for (int i = 0; i < row_len; i++)
+                sums[i] = s[i];
+            for (int r = 1; r < k; r++)
+            {
+                s = bgr.ptr(y0 + y * k + r) + x0 * 3;
+                for (int i = 0; i < row_len; i++)
+                    sums[i] += s[i];
+            }
+
+            float *pr = out.channel(0).row(y), *pg = out.channel(1).row(y), *pb = out.channel(2).row(y);
+            const uint16_t *p = sums.data();
+            for (int x = 0; x < w; x++, p += k * 3)
+            {
+                int b = 0, g = 0, rr = 0;
+                for (int i = 0; i < k; i++)
+                {
+                    b += p[i * 3];
+                    g += p[i * 3 + 1];
+                    rr += p[i * 3 + 2];
+                }
+                // 0..255 like from_pixels_resize; the caller normalizes
+                pr[x] = rr * inv;
+                pg[x] = g * inv;
+                pb[x] = b * inv;
+            }
+        }
+    }
+}
+
+ncnn::Mat resize_bgr_to_rgb(const cv::Mat &bgr, int w, int h, bool fast, int num_threads)
+{
+    const int k = fast ? box_factor(bgr.cols, bgr.rows, w, h) : 0;
+    if (k == 0)
+    {
+        if (bgr.isContinuous())
+            return ncnn::Mat::from_pixels_resize(bgr.data, ncnn::Mat::PIXEL_BGR2RGB, bgr.cols, bgr.rows, w, h);
+        return ncnn::Mat::from_pixels_resize(bgr.data, ncnn::Mat::PIXEL_BGR2RGB, bgr.cols, bgr.rows, (int)bgr.step, w, h);
+    }
+
+    ncnn::Mat out(w, h, 3);
+    const int x0 = (bgr.cols - k * w) / 2, y0 = (bgr.rows - k * h) / 2;
+    if (k == 2)
+        box_downscale<2>(bgr, k, x0, y0, out, num_threads);
+    else if (k == 3)
+        box_downscale<3>(bgr, k, x0, y0, out, num_threads);
+    else if (k == 4)
+        box_downscale<4>(bgr, k, x0, y0, out, num_threads);
+    else
+        box_downscale<0>(bgr, k, x0, y0, out, num_threads);
+    return out;
+}
+
+// RGB float planes back to an 8-bit BGR image for comparison
+static cv::Mat to_bgr(const ncnn::Mat &m)
+{
+    cv::Mat img(m.h, m.w, CV_8UC3);
+    m.to_pixels(img.data, ncnn::Mat::PIXEL_RGB2BGR);
+    return img;
+}
+
+int run_resize_compare(const std::string &image_path, int target_size)
+{
+    std::vector<cv::Mat> images = load_images(image_path);
+    if (images.empty())
+    {
+        fprintf(stderr, "No images found in %s\n", image_path.c_str());
+        return -1;
+    }
+
+    const cv::Size cameras[] = {cv::Size(960, 540), cv::Size(1280, 720), cv::Size(1920, 1080), cv::Size(2560, 1440)};
+    const int reps = 10;
+    printf("%-10s %-8s %-4s %10s %10s %12s %12s %12s\n", "camera", "input", "box", "bilinear", "fast", "fast-vs-bil", "bil-vs-area", "fast-vs-area");
+    for (const cv::Size &cam : cameras)
+    {
+        // same letterbox size as detect()
+        const float scale = cam.width > cam.height ? (float)target_size / cam.width : (float)target_size / cam.height;
+        const int w = cam.width > cam.height ? target_size : (int)(cam.width * scale);
+        const int h = cam.width > cam.height ? (int)(cam.height * scale) : target_size;
+
+        double bilinear_ms = 0, fast_ms = 0, psnr_same = 0, psnr_bilinear = 0, psnr_fast = 0;
+        for (const cv::Mat &img : images)
+        {
+            cv::Mat frame;
+            cv::resize(img, frame, cam, 0, 0, cv::INTER_AREA);
+            ncnn::Mat a, b;
+            auto t0 = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < reps; i++)
+                a = resize_bgr_to_rgb(frame, w, h, false);
+            auto t1 = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < reps; i++)
+                b = resize_bgr_to_rgb(frame, w, h, true);
+            auto t2 = std::chrono::high_resolution_clock::now();
+            bilinear_ms += std::chrono::duration<double, std::milli>(t1 - t0).count() / reps;
+            fast_ms += std::chrono::duration<double, std::milli>(t2 - t1).count() / reps;
+
+            cv::Mat reference;
+            cv::resize(frame, reference, cv::Size(w, h), 0, 0, cv::INTER_AREA);
+            cv::Mat ia = to_bgr(a), ib = to_bgr(b);
+            psnr_same += std::min(cv::PSNR(ia, ib), 99.0);
+            psnr_bilinear += std::min(cv::PSNR(ia, reference), 99.0);
+            psnr_fast += std::min(cv::PSNR(ib, reference), 99.0);
+        }
+        const double n = images.size();
+        char camera[32], input[32];
+        snprintf(camera, sizeof(camera), "%dx%d", cam.width, cam.height);
+        snprintf(input, sizeof(input), "%dx%d", w, h);
+        printf("%-10s %-8s %-4d %8.3fms %8.3fms %10.2fdB %10.2fdB %10.2fdB\n", camera, input, box_factor(cam.width, cam.height, w, h), bilinear_ms / n,
+               fast_ms / n, psnr_same / n, psnr_bilinear / n, psnr_fast / n);
+    }
+    return 0;
+}
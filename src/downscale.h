@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <opencv2/opencv.hpp>
+#include "net.h"
+
+// Letterbox resize of the CPU preprocessing path. Camera frames are often
+// an exact multiple of the network input (960x540 and 1920x1080 to
+// 480x270 are 2x and 4x), and there a k x k box filter does the whole
+// resize. It reads every source pixel once with unit-stride loops the
+// compiler vectorizes, and averages instead of point-sampling, so it also
+// aliases less than bilinear. Other ratios use ncnn's bilinear resize.
+
+// Box factor k (2..16) when src_w x src_h is within 1% of k*w x k*h; the
+// extra rows/columns are cropped evenly. 0 when bilinear has to be used.
+int box_factor(int src_w, int src_h, int w, int h);
+
+// bgr (CV_8UC3) resized to w x h as RGB float planes, the same layout as
+// ncnn::Mat::from_pixels_resize(PIXEL_BGR2RGB). fast = false always uses
+// bilinear. The box filter runs on num_threads threads, the same count the
+// ncnn backends use.
+ncnn::Mat resize_bgr_to_rgb(const cv::Mat &bgr, int w, int h, bool fast = true, int num_threads = 3);
+
+// Times both resize paths on every image under image_path, rescaled to
+// common camera resolutions, and reports their PSNR against each other
+// and against an INTER_AREA reference.
+int run_resize_compare(const std::string &image_path, int target_size = 480);
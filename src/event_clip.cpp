@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <time.h>
+#include "async_io.h"
+#include "event_clip.h"
+#include "jpeg_stream.h"
+
+ClipRecorder::ClipRecorder(const ClipOptions &opt)
+    : opt(opt)
+{
+    writer = std::thread(&ClipRecorder::write_jobs, this);
+}
+
+ClipRecorder::~ClipRecorder()
+{
+    if (!clip.dir.empty())
+        close_clip();
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        done = true;
+        cond.notify_one();
+    }
+    writer.join();
+}
+
+void ClipRecorder::enqueue(Job job)
+{
+    std::lock_guard<std::mutex> lk(lock);
+    if (job.jpeg)
+        job_bytes += job.jpeg->size();
+    jobs.push_back(std::move(job));
+    cond.notify_one();
+}
+
+void ClipRecorder::write_jobs()
+{
+    AsyncFileIO io;
+    std::string failed_dir;
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lk(lock);
+            cond.wait(lk, [&]() { return done || !jobs.empty(); });
+            if (jobs.empty())
+                break;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            if (job.jpeg)
+                job_bytes -= job.jpeg->size();
+        }
+
+        if (job.jpeg)
+        {
+            if (failed_dir.empty() || job.path.compare(0, failed_dir.size(), failed_dir) != 0)
+                io.write(job.path, *job.jpeg);
+        }
+        else if (job.trace)
+        {
+            if (job.trace->dir != failed_dir && !save_trace(*job.trace))
+                fprintf(stderr, "[WARN] Cannot write %s/trace.csv\n", job.trace->dir.c_str());
+        }
+        else
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(job.path, ec);
+            if (ec)
+            {
+                fprintf(stderr, "[WARN] Cannot create %s: %s\n", job.path.c_str(), ec.message().c_str());
+                failed_dir = job.path;
+            }
+        }
+    }
+    // leaving the scope waits for the last writes
+}
+
+// first detection with a configured label, -1 without
+static int trigger_label(const std::vector<Object> &objects, const std::vector<int> &labels)
+{
+    for (const auto &obj : objects)
+        if (labels.empty() || std::find(labels.begin(), labels.end(), obj.label) != labels.end())
+            return obj.label;
+    return -1;
+}
+
+void ClipRecorder::push(std::vector<unsigned char> jpeg, int64_t time_us, const std::vector<Object> &objects)
+{
+    const int64_t oldest_us = time_us - (int64_t)(opt.pre_s * 1e6);
+    while (!ring.empty() && ring.front().time_us < oldest_us)
+    {
+        ring_bytes -= ring.front().jpeg->size();
+        ring.pop_front();
+    }
+
+    const int label = trigger_label(objects, opt.labels);
+    Frame frame{time_us, std::make_shared<const std::vector<unsigned char>>(std::move(jpeg))};
+    if (clip.dir.empty() && label >= 0)
+        open_clip(time_us, label);
+    if (!clip.dir.empty())
+    {
+        add_to_clip(frame);
+        if (label >= 0)
+            clip_until_us = time_us + (int64_t)(opt.post_s * 1e6);
+        else if (time_us >= clip_until_us)
+            close_clip();
+    }
+
+    // frames of an open clip stay in the ring too, so a clip following
+    // right after it still starts with a full pre-roll
+    ring_bytes += frame.jpeg->size();
+    ring.push_back(std::move(frame));
+    while (!ring.empty() && ring_bytes > opt.max_bytes)
+    {
+        ring_bytes -= ring.front().jpeg->size();
+        ring.pop_front();
+    }
+}
+
+void ClipRecorder::open_clip(int64_t time_us, int label)
+{
+    char stamp[32], name[64];
+    const time_t now = time(0);
+    tm local;
+    localtime_r(&now, &local);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+    snprintf(name, sizeof(name), "/%s-%03d", stamp, clip_count);
+
+    clip = Trace();
+    clip.dir = opt.out_dir + name;
+    enqueue(Job{clip.dir, nullptr, nullptr});
+    clip_start_us = ring.empty() ? time_us : ring.front().time_us;
+    clip_count++;
+    printf("[CLIP] %s: label %d, %.1f s pre-roll\n", clip.dir.c_str(), label, (time_us - clip_start_us) / 1e6);
+    for (const Frame &f : ring)
+        add_to_clip(f);
+}
+
+void ClipRecorder::add_to_clip(const Frame &frame)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%06zu.jpg", clip.frames.size());
+    TraceFrame fr;
+    fr.arrival_us = frame.time_us - clip_start_us;
+    fr.file = name;
+    {
+        // twice the ring budget leaves room for a full pre-roll on top of
+        // the last clip's backlog
+        std::lock_guard<std::mutex> lk(lock);
+        if (job_bytes + frame.jpeg->size() > 2 * opt.max_bytes)
+        {
+            dropped_frames++;
+            return;
+        }
+    }
+    clip.frames.push_back(fr);
+    enqueue(Job{clip.dir + "/" + fr.file, frame.jpeg, nullptr});
+    written_frames++;
+}
+
+void ClipRecorder::close_clip()
+{
+    enqueue(Job{clip.dir, nullptr, std::make_shared<const Trace>(clip)});
+    printf("[CLIP] %s: %zu frames, %.1f s\n", clip.dir.c_str(), clip.frames.size(),
+           clip.frames.empty() ? 0.0 : clip.frames.back().arrival_us / 1e6);
+    clip = Trace();
+}
+
+int run_event_clips(YoloV11 &yolo, const std::string &source, const ClipOptions &opt, int max_frames)
+{
+    // a trace directory of JPEGs is read as is, one referencing a video
+    // plays that video
+    Trace trace;
+    bool from_trace = load_trace(source, trace);
+    cv::VideoCapture cap;
+    if ((!from_trace || !trace.video.empty()) && !open_source(cap, from_trace ? trace.video : source))
+    {
+        fprintf(stderr, "Failed to open source: %s\n", source.c_str());
+        return -1;
+    }
+    from_trace = from_trace && trace.video.empty();
+
+    // ask cameras for their MJPEG bitstream, it goes into the ring unchanged
+    bool passthrough = false;
+    if (!from_trace && (source.find_first_not_of("0123456789") == std::string::npos || source.rfind("/dev/video", 0) == 0))
+    {
+        cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'));
+        passthrough = cap.set(cv::CAP_PROP_CONVERT_RGB, 0);
+    }
+
+    const std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, opt.jpeg_quality};
+    std::vector<Object> objects;
+    int frames = 0, encoded = 0, clips = 0, written = 0, dropped = 0;
+    double detect_ms = 0;
+    const auto start = std::chrono::steady_clock::now();
+    {
+        ClipRecorder recorder(opt);
+        cv::Mat frame, img;
+        for (size_t i = 0; max_frames <= 0 || frames < max_frames; i++)
+        {
+            std::vector<unsigned char> jpeg;
+            int64_t time_us;
+            img.release();
+            if (from_trace)
+            {
+                if (i >= trace.frames.size())
+                    break;
+                std::ifstream f(trace.dir + "/" + trace.frames[i].file, std::ios::binary);
+                jpeg.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+                time_us = trace.frames[i].arrival_us;
+            }
+            else
+            {
+                if (!cap.read(frame))
+                    break;
+                time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+                if (passthrough && frame.rows == 1 && frame.total() > 2 && frame.ptr()[0] == 0xFF && frame.ptr()[1] == 0xD8)
+                {
+                    jpeg.assign(frame.ptr(), frame.ptr() + frame.total());
+                }
+                else if (passthrough)
+                {
+                    // not MJPEG after all, take decoded frames from now on
+                    passthrough = false;
+                    cap.set(cv::CAP_PROP_CONVERT_RGB, 1);
+                    if (frame.channels() != 3)
+                        continue;
+                }
+                if (jpeg.empty())
+                    img = frame;
+            }
+
+            if (!jpeg.empty())
+            {
+                // only the detector needs pixels, at input size
+                cv::Size full;
+                if (!decode_jpeg_fit(jpeg.data(), jpeg.size(), TARGET_SIZE, img, full))
+                    img = cv::imdecode(jpeg, cv::IMREAD_COLOR);
+            }
+            else if (!img.empty())
+            {
+                cv::imencode(".jpg", img, jpeg, params);
+                encoded++;
+            }
+            if (img.empty())
+            {
+                fprintf(stderr, "[WARN] Cannot decode frame %zu\n", i);
+                continue;
+            }
+
+            auto t0 = std::chrono::high_resolution_clock::now();
+            yolo.detect(img, objects);
+            detect_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+            recorder.push(std::move(jpeg), time_us, objects);
+            frames++;
+        }
+        clips = recorder.clips();
+        written = recorder.written();
+        dropped = recorder.dropped();
+        // leaving the scope closes the last clip and waits for its writes
+    }
+    const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("[CLIP] %d frames in %.1f s (%d JPEG-encoded), detect %.1f ms/frame, %d clips with %d frames in %s\n", frames, wall_s,
+           encoded, frames ? detect_ms / frames : 0.0, clips, written, opt.out_dir.c_str());
+    if (dropped)
+        fprintf(stderr, "[WARN] Clip writer fell behind, %d frames dropped\n", dropped);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "trace.h"
+#include "yolo11.h"
+
+struct ClipOptions
+{
+    std::string out_dir = "clips";
+    std::vector<int> labels;     // detector labels that start or extend a clip, empty = any
+    double pre_s = 5;            // pre-roll kept in memory
+    double post_s = 5;           // recorded after the last triggering frame
+    size_t max_bytes = 64 << 20; // ring budget, trims the pre-roll of high bitrate sources
+    int jpeg_quality = 80;       // for sources that deliver raw frames
+};
+
+// Keeps the last pre_s seconds of compressed frames in memory. A frame
+// whose detections include one of the labels opens a clip holding that
+// pre-roll and everything up to post_s after the last triggering frame.
+// Clips are trace directories (JPEGs plus trace.csv, see trace.h), so
+// --replay plays them back. Directories, frames and trace.csv are written on
+// a writer thread; push() only queues references to the ring's buffers, so
+// opening a clip with a full pre-roll costs the capture loop no I/O. When
+// the writer falls behind by more than twice max_bytes, new clip frames are
+// dropped and counted. Nothing is written between events.
+class ClipRecorder
+{
+public:
+    explicit ClipRecorder(const ClipOptions &opt);
+    // closes the open clip and waits for its writes
+    ~ClipRecorder();
+
+    // jpeg: the frame as captured, time_us: capture time
+    void push(std::vector<unsigned char> jpeg, int64_t time_us, const std::vector<Object> &objects);
+
+    int clips() const { return clip_count; }
+    int written() const { return written_frames; }
+    int dropped() const { return dropped_frames; }
+
+private:
+    struct Frame
+    {
+        int64_t time_us;
+        std::shared_ptr<const std::vector<unsigned char>> jpeg;
+    };
+    // writer thread work, in queue order: jpeg set writes a frame to path,
+    // trace set writes its trace.csv, neither creates the directory path
+    struct Job
+    {
+        std::string path;
+        std::shared_ptr<const std::vector<unsigned char>> jpeg;
+        std::shared_ptr<const Trace> trace;
+    };
+
+    void open_clip(int64_t time_us, int label);
+    void add_to_clip(const Frame &frame);
+    void close_clip();
+    void enqueue(Job job);
+    void write_jobs();
+
+    ClipOptions opt;
+    std::deque<Frame> ring;
+    size_t ring_bytes = 0;
+
+    Trace clip; // dir empty while no clip is open
+    int64_t clip_start_us = 0, clip_until_us = 0;
+    int clip_count = 0, written_frames = 0, dropped_frames = 0;
+
+    std::mutex lock;
+    std::condition_variable cond;
+    std::deque<Job> jobs;
+    size_t job_bytes = 0;
+    bool done = false;
+    std::thread writer;
+};
+
+// Runs the detector over every frame of source (camera index, device,
+// stream URL, video file or trace directory) and records clips around the
+// detections. MJPEG cameras and trace JPEGs are kept as delivered; other
+// sources are JPEG-encoded once per frame.
+int run_event_clips(YoloV11 &yolo, const std::string &source, const ClipOptions &opt, int max_frames = 0);
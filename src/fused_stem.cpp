@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <limits.h>
+#include <string.h>
+#include "fused_stem.h"
+#include "layer.h"
+#include "model_tools.h"
+
+// Convolution with 3 input channels whose input is either the uint8 BGR
+// frame (elemsize 3, w x h = frame size) plus the letterbox geometry blob
+// (src_w, src_h, rw, rh, pad_left, pad_top, w, h), or an already
+// preprocessed fp32 CHW tensor. Reads the same weight blobs as the
+// Convolution it replaces; int8 weights are dequantized at load time.
+class YoloStem : public ncnn::Layer
+{
+public:
+    YoloStem()
+    {
+        one_blob_only = false;
+        support_inplace = false;
+    }
+
+    int load_param(const ncnn::ParamDict &pd)
+    {
+        num_output = pd.get(0, 0);
+        kernel_w = pd.get(1, 0);
+        kernel_h = pd.get(11, kernel_w);
+        stride_w = pd.get(3, 1);
+        stride_h = pd.get(13, stride_w);
+        pad_w = pd.get(4, 0);
+        pad_h = pd.get(14, pad_w);
+        bias_term = pd.get(5, 0);
+        weight_data_size = pd.get(6, 0);
+        int8_scale_term = pd.get(8, 0);
+        return weight_data_size == num_output * 3 * kernel_w * kernel_h ? 0 : -1;
+    }
+
+    int load_model(const ncnn::ModelBin &mb)
+    {
+        ncnn::Mat weights = mb.load(weight_data_size, 0);
+        if (weights.empty())
+            return -100;
+        if (bias_term)
+        {
+            bias_data = mb.load(num_output, 1);
+            if (bias_data.empty())
+                return -100;
+        }
+
+        ncnn::Mat weight_scales;
+        if (int8_scale_term)
+        {
+            weight_scales = mb.load(num_output, 1);
+            ncnn::Mat bottom_scale = mb.load(1, 1);
+            if (int8_scale_term > 100)
+                mb.load(1, 1);
+            if (weight_scales.empty() || bottom_scale.empty())
+                return -100;
+        }
+
+        weight_data.create(weight_data_size);
+        if (weights.elemsize == 1 && !weight_scales.empty())
+        {
+            // int8 weights are round(w * scale) per output channel
+            const int per_output = weight_data_size / num_output;
+            const signed char *q = weights;
+            for (int i = 0; i < weight_data_size; i++)
+                weight_data[i] = q[i] / weight_scales[i / per_output];
+        }
+        else
+        {
+            memcpy(weight_data.data, weights.data, weight_data_size * sizeof(float));
+        }
+        return 0;
+    }
+
+    int forward(const std::vector<ncnn::Mat> &bottom_blobs, std::vector<ncnn::Mat> &top_blobs, const ncnn::Option &opt) const
+    {
+        const ncnn::Mat &src = bottom_blobs[0];
+        const float *geom = bottom_blobs[1];
+        const bool frame = src.elemsize == 3;
+        if (!frame && src.c != 3)
+            return -1;
+
+        const int src_w = frame ? (int)geom[0] : src.w, src_h = frame ? (int)geom[1] : src.h;
+        const int rw = frame ? (int)geom[2] : src.w, rh = frame ? (int)geom[3] : src.h;
+        const int lb_left = frame ? (int)geom[4] : 0, lb_top = frame ? (int)geom[5] : 0;
+        const int w = frame ? (int)geom[6] : src.w, h = frame ? (int)geom[7] : src.h;
+
+        const int outw = (w + 2 * pad_w - kernel_w) / stride_w + 1;
+        const int outh = (h + 2 * pad_h - kernel_h) / stride_h + 1;
+        ncnn::Mat &top_blob = top_blobs[0];
+        top_blob.create(outw, outh, num_output, 4u, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        // horizontal source taps of every letterboxed column, -1 in the padding;
+        // same sampling as ncnn's resize_bilinear (pixel centers, clamped)
+        std::vector<int> xofs(w, -1), xofs1(w, -1);
+        std::vector<float> xalpha(w, 0.f);
+        if (frame)
+        {
+            const float scale_x = (float)src_w / rw;
+            for (int x = 0; x < w; x++)
+            {
+                const int lx = x - lb_left;
+                if (lx < 0 || lx >= rw)
+                    continue;
+                const float fx = std::min(std::max((lx + 0.5f) * scale_x - 0.5f, 0.f), (float)(src_w - 1));
+                const int x0 = (int)fx;
+                xofs[x] = x0 * 3;
+                xofs1[x] = std::min(x0 + 1, src_w - 1) * 3;
+                xalpha[x] = fx - x0;
+            }
+        }
+        const float scale_y = frame ? (float)src_h / rh : 1.f;
+        const unsigned char *pixels = frame ? (const unsigned char *)src.data : 0;
+        const size_t src_stride = (size_t)src_w * 3;
+
+        // Input rows, convolution padding included, are kept split by stride
+        // phase: plane ph of a channel holds columns ph, ph + s, ph + 2s, ...
+        // so tap kx of output column ox is plane kx % s at ox + kx / s and
+        // the inner loop runs at unit stride. Each thread caches kernel_h
+        // rows in slot iy % kernel_h; its output rows are contiguous, so with
+        // stride_h < kernel_h the overlapping rows are built once, not once
+        // per output row that reads them.
+        const int bw = w + 2 * pad_w;
+        const int s = stride_w;
+        const int tile = 16;
+        const int pw = (bw + s - 1) / s + tile; // a last partial tile reads past the row
+        const size_t plane = (size_t)s * pw;     // one channel of a row
+        const int num_taps = 3 * kernel_h * kernel_w;
+        const float *weights = weight_data;
+
+#pragma omp parallel num_threads(opt.num_threads)
+        {
+            std::vector<float> rows((size_t)kernel_h * 3 * plane);
+            std::vector<int> row_y(kernel_h, INT_MIN);
+            std::vector<float> line((size_t)3 * bw);
+            std::vector<const float *> taps(num_taps);
+
+#pragma omp for schedule(static)
+            for (int oy = 0; oy < outh; oy++)
+            {
+                for (int ky = 0; ky < kernel_h; ky++)
+                {
+                    const int iy = oy * stride_h - pad_h + ky;
+                    const int slot = ((iy % kernel_h) + kernel_h) % kernel_h;
+                    if (row_y[slot] == iy)
+                        continue;
+                    row_y[slot] = iy;
+
+                    float *r = line.data();
+                    std::fill(r, r + 3 * bw, 0.f);
+                    float *pr = r + pad_w, *pg = pr + bw, *pb = pg + bw;
+                    const int ly = iy - lb_top;
+                    if (iy < 0 || iy >= h)
+                    {
+                        // convolution padding, zeros
+                    }
+                    else if (!frame)
+                    {
+                        memcpy(pr, src.channel(0).row(iy), w * sizeof(float));
+                        memcpy(pg, src.channel(1).row(iy), w * sizeof(float));
+                        memcpy(pb, src.channel(2).row(iy), w * sizeof(float));
+                    }
+                    else if (ly < 0 || ly >= rh)
+                    {
+                        std::fill(pr, pr + w, 114 / 255.f);
+                        std::fill(pg, pg + w, 114 / 255.f);
+                        std::fill(pb, pb + w, 114 / 255.f);
+                    }
+                    else
+                    {
+                        const float fy = std::min(std::max((ly + 0.5f) * scale_y - 0.5f, 0.f), (float)(src_h - 1));
+                        const int y0 = (int)fy;
+                        const float ay = fy - y0;
+                        const unsigned char *s0 = pixels + y0 * src_stride;
+                        const unsigned char *s1 = pixels + std::min(y0 + 1, src_h - 1) * src_stride;
+                        for (int x = 0; x < w; x++)
+                        {
+                            if (xofs[x] < 0)
+                            {
+                                pr[x] = pg[x] = pb[x] = 114 / 255.f;
+                                continue;
+                            }
+                            const int o0 = xofs[x], o1 = xofs1[x];
+                            const float ax = xalpha[x];
+                            float bgr[3];
+                            for (int k = 0; k < 3; k++)
+                            {
+                                const float t = s0[o0 + k] + (s0[o1 + k] - s0[o0 + k]) * ax;
+                                const float b = s1[o0 + k] + (s1[o1 + k] - s1[o0 + k]) * ax;
+                                bgr[k] = (t + (b - t) * ay) * (1 / 255.f);
+                            }
+                            pr[x] = bgr[2];
+                            pg[x] = bgr[1];
+                            pb[x] = bgr[0];
+                        }
+                    }
+
+                    float *dst = &rows[(size_t)slot * 3 * plane];
+                    for (int c = 0; c < 3; c++)
+                    {
+                        const float *from = r + (size_t)c * bw;
+                        float *to = dst + (size_t)c * plane;
+                        for (int ph = 0; ph < s; ph++)
+                        {
+                            float *q = to + (size_t)ph * pw;
+                            int j = 0;
+                            for (int x = ph; x < bw; x += s)
+                                q[j++] = from[x];
+                            std::fill(q + j, q + pw, 0.f);
+                        }
+                    }
+                }
+
+                // every tap as a unit-stride row, in weight order (c, ky, kx)
+                for (int c = 0; c < 3; c++)
+                {
+                    for (int ky = 0; ky < kernel_h; ky++)
+                    {
+                        const int iy = oy * stride_h - pad_h + ky;
+                        const float *row = &rows[(size_t)(((iy % kernel_h) + kernel_h) % kernel_h) * 3 * plane + (size_t)c * plane];
+                        for (int kx = 0; kx < kernel_w; kx++)
+                            taps[(c * kernel_h + ky) * kernel_w + kx] = row + (size_t)(kx % s) * pw + kx / s;
+                    }
+                }
+
+                // a tile of output columns accumulates all taps in registers
+                // and is stored once
+                for (int oc = 0; oc < num_output; oc++)
+                {
+                    float *out = top_blob.channel(oc).row(oy);
+                    const float *k = weights + (size_t)oc * num_taps;
+                    const float bias = bias_term ? bias_data[oc] : 0.f;
+                    for (int ox0 = 0; ox0 < outw; ox0 += tile)
+                    {
+                        float acc[tile];
+                        for (int i = 0; i < tile; i++)
+                            acc[i] = bias;
+                        for (int t = 0; t < num_taps; t++)
+                        {
+                            const float wv = k[t];
+                            const float *p = taps[t] + ox0;
+                            for (int i = 0; i < tile; i++)
+                                acc[i] += wv * p[i];
+                        }
+                        memcpy(out + ox0, acc, std::min(tile, outw - ox0) * sizeof(float));
+                    }
+                }
+            }
+        }
+        return 0;
+    }
+
+    int num_output = 0, kernel_w = 0, kernel_h = 0, stride_w = 1, stride_h = 1, pad_w = 0, pad_h = 0;
+    int bias_term = 0, weight_data_size = 0, int8_scale_term = 0;
+    ncnn::Mat weight_data, bias_data; // fp32
+};
+
+DEFINE_LAYER_CREATOR(YoloStem)
+
+// Swaps the convolution reading in0 for YoloStem and adds the lb0 input for
+// the letterbox geometry. Only plain convolutions with symmetric padding
+// and no fused activation qualify.
+static bool rewrite_stem(ParamGraph &g, std::string &stem_layer)
+{
+    std::vector<int> users = g.consumers("in0");
+    if (users.size() != 1)
+        return false;
+    ParamLayer &conv = g.layers[users[0]];
+    if (conv.type != "Convolution")
+        return false;
+    const int pad_left = std::stoi(conv.param(4, "0"));
+    const int pad_top = std::stoi(conv.param(14, std::to_string(pad_left)));
+    if (conv.param(2, "1") != "1" || conv.param(12, "1") != "1" || conv.param(7, "1") != "1" || conv.param(9, "0") != "0" || !conv.param(18).empty() ||
+        pad_left < 0 || pad_top < 0 || std::stoi(conv.param(15, std::to_string(pad_left))) != pad_left ||
+        std::stoi(conv.param(16, std::to_string(pad_top))) != pad_top)
+        return false;
+
+    conv.type = "YoloStem";
+    conv.bottoms.push_back("lb0");
+    stem_layer = conv.name;
+
+    ParamLayer input;
+    input.type = "Input";
+    input.name = "lb0";
+    input.tops.push_back("lb0");
+    g.layers.insert(g.layers.begin(), input);
+    return true;
+}
+
+FusedStemNcnnBackend::FusedStemNcnnBackend(const std::string &model_path, bool int8)
+    : NcnnBackend(false, int8, -1, model_path)
+{
+    ParamGraph graph;
+    if (load_param_graph(model_path + ".param", graph) && rewrite_stem(graph, stem_layer))
+    {
+        net.register_custom_layer("YoloStem", YoloStem_layer_creator);
+        fused = net.load_param_mem(format_param_graph(graph).c_str()) == 0 && net.load_model((model_path + ".bin").c_str()) == 0;
+        if (!fused)
+            net.clear();
+    }
+    if (!fused)
+    {
+        printf("[WARN] %s: first convolution cannot be fused, using the regular input path\n", model_path.c_str());
+        stem_layer.clear();
+        net.load_param((model_path + ".param").c_str());
+        net.load_model((model_path + ".bin").c_str());
+    }
+}
+
+std::string FusedStemNcnnBackend::describe() const
+{
+    return NcnnBackend::describe() + (fused ? " fused_stem=" + stem_layer : std::string(" fused_stem=off"));
+}
+
+int FusedStemNcnnBackend::run(const ncnn::Mat &in, const Letterbox &lb, std::vector<ncnn::Mat> &outs, int num_outputs)
+{
+    ncnn::Extractor ex = net.create_extractor();
+    ex.input("in0", in);
+    if (fused)
+    {
+        ncnn::Mat geom(8);
+        const int values[8] = {lb.src_w, lb.src_h, lb.rw, lb.rh, lb.pad_left, lb.pad_top, lb.w, lb.h};
+        for (int i = 0; i < 8; i++)
+            geom[i] = (float)values[i];
+        ex.input("lb0", geom);
+    }
+
+    outs.resize(num_outputs);
+    for (int i = 0; i < num_outputs; i++)
+    {
+        std::string blob = "out" + std::to_string(i);
+        int ret = ex.extract(blob.c_str(), outs[i]);
+        if (ret != 0)
+            return ret;
+    }
+    return 0;
+}
+
+int FusedStemNcnnBackend::infer(const ncnn::Mat &in, std::vector<ncnn::Mat> &outs, int num_outputs)
+{
+    // the stem ignores the geometry for float input
+    return run(in, Letterbox(), outs, num_outputs);
+}
+
+int FusedStemNcnnBackend::infer_bgr(const cv::Mat &bgr, const Letterbox &lb, std::vector<ncnn::Mat> &outs, int num_outputs)
+{
+    if (!fused || bgr.type() != CV_8UC3)
+        return -1;
+
+    // the stem addresses the frame as packed rows; a ROI is copied first
+    cv::Mat frame = bgr.isContinuous() ? bgr : bgr.clone();
+    ncnn::Mat in(lb.src_w, lb.src_h, (void *)frame.data, (size_t)3u, 1);
+    return run(in, lb, outs, num_outputs);
+}
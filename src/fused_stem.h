@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "backend.h"
+
+// ncnn backend whose first convolution (in0 -> stem, 3 input channels) is
+// replaced at load time by YoloStem, a custom layer computing it straight
+// from the interleaved uint8 BGR frame. Each output row builds only the
+// kernel_h letterboxed input rows it reads (bilinear resize, BGR->RGB, 114
+// padding and 1/255 in one pass) in a small per-thread buffer, so the
+// w x h x 3 float input tensor never exists. The rest of the network is
+// unchanged. CPU only; infer() still takes a preprocessed float input.
+class FusedStemNcnnBackend : public NcnnBackend
+{
+public:
+    // Models whose first layer cannot be replaced (or .ncnnz containers)
+    // load unchanged and run the regular preprocessing path.
+    FusedStemNcnnBackend(const std::string &model_path, bool int8 = false);
+
+    const char *name() const { return "ncnn-fused-stem"; }
+    std::string describe() const;
+    int infer(const ncnn::Mat &in, std::vector<ncnn::Mat> &outs, int num_outputs);
+
+    bool accepts_bgr() const { return fused; }
+    bool bgr_on_gpu() const { return false; }
+    int infer_bgr(const cv::Mat &bgr, const Letterbox &lb, std::vector<ncnn::Mat> &outs, int num_outputs);
+
+private:
+    int run(const ncnn::Mat &in, const Letterbox &lb, std::vector<ncnn::Mat> &outs, int num_outputs);
+
+    bool fused = false;
+    std::string stem_layer; // name of the replaced convolution
+};
@@ -0,0 +1,150 @@
+#include "gpu_preprocess.h"
+
+#if NCNN_VULKAN
+#include <string.h>
+#include "command.h"
+#include "gpu.h"
+#include "pipeline.h"
+
+// The frame is bound as a uint buffer and bytes are unpacked in the shader,
+// so no 8-bit storage extension is needed. Sampling matches ncnn's
+// resize_bilinear (pixel centers, clamped at the border).
+static const char letterbox_comp[] = R"(
+#version 450
+
+layout (local_size_x_id = 233) in;
+layout (local_size_y_id = 234) in;
+layout (local_size_z_id = 235) in;
+
+layout (binding = 0) readonly buffer src_blob { uint src_data[]; };
+layout (binding = 1) writeonly buffer dst_blob { float dst_data[]; };
+
+layout (push_constant) uniform parameter
+{
+    int src_w;
+    int src_h;
+    int src_stride;
+    int rw;
+    int rh;
+    int pad_left;
+    int pad_top;
+    int w;
+    int h;
+    int cstep;
+    float scale_x;
+    float scale_y;
+} p;
+
+float load_byte(int offset)
+{
+    return float((src_data[offset >> 2] >> ((offset & 3) * 8)) & 0xffu);
+}
+
+vec3 load_bgr(int x, int y)
+{
+    int offset = y * p.src_stride + x * 3;
+    return vec3(load_byte(offset), load_byte(offset + 1), load_byte(offset + 2));
+}
+
+void main()
+{
+    int gx = int(gl_GlobalInvocationID.x);
+    int gy = int(gl_GlobalInvocationID.y);
+    if (gx >= p.w || gy >= p.h)
+        return;
+
+    vec3 bgr = vec3(114.0);
+    int x = gx - p.pad_left;
+    int y = gy - p.pad_top;
+    if (x >= 0 && x < p.rw && y >= 0 && y < p.rh)
+    {
+        float fx = clamp((float(x) + 0.5) * p.scale_x - 0.5, 0.0, float(p.src_w - 1));
+        float fy = clamp((float(y) + 0.5) * p.scale_y - 0.5, 0.0, float(p.src_h - 1));
+        int x0 = int(fx);
+        int y0 = int(fy);
+        int x1 = min(x0 + 1, p.src_w - 1);
+        int y1 = min(y0 + 1, p.src_h - 1);
+        float ax = fx - float(x0);
+        float ay = fy - float(y0);
+        vec3 top = mix(load_bgr(x0, y0), load_bgr(x1, y0), ax);
+        vec3 bottom = mix(load_bgr(x0, y1), load_bgr(x1, y1), ax);
+        bgr = mix(top, bottom, ay);
+    }
+
+    int gi = gy * p.w + gx;
+    dst_data[gi] = bgr.z / 255.0;
+    dst_data[p.cstep + gi] = bgr.y / 255.0;
+    dst_data[2 * p.cstep + gi] = bgr.x / 255.0;
+}
+)";
+
+VulkanLetterbox::VulkanLetterbox(const ncnn::VulkanDevice *vkdev, const ncnn::Option &opt)
+    : vkdev(vkdev)
+{
+    std::vector<uint32_t> spirv;
+    if (ncnn::compile_spirv_module(letterbox_comp, sizeof(letterbox_comp) - 1, opt, spirv) != 0)
+    {
+        fprintf(stderr, "[WARN] Letterbox shader failed to compile, preprocessing stays on the CPU\n");
+        return;
+    }
+    pipeline = new ncnn::Pipeline(vkdev);
+    pipeline->set_optimal_local_size_xyz(8, 8, 1);
+    if (pipeline->create(spirv.data(), spirv.size() * 4, std::vector<ncnn::vk_specialization_type>()) != 0)
+    {
+        fprintf(stderr, "[WARN] Letterbox pipeline creation failed, preprocessing stays on the CPU\n");
+        delete pipeline;
+        pipeline = 0;
+    }
+}
+
+VulkanLetterbox::~VulkanLetterbox()
+{
+    delete pipeline;
+}
+
+void VulkanLetterbox::record(ncnn::VkCompute &cmd, const cv::Mat &bgr, const Letterbox &lb, ncnn::Mat &raw, ncnn::VkMat &upload, ncnn::VkMat &fp32,
+                             ncnn::VkMat &dst, const ncnn::Option &opt) const
+{
+    // pack the rows (bgr may be a ROI) into a word buffer with one spare
+    // word, so the shader's last uint read stays inside the upload
+    const int stride = lb.src_w * 3;
+    const int words = (stride * lb.src_h + 3) / 4 + 1;
+    raw.create(words, (size_t)4u);
+    for (int y = 0; y < lb.src_h; y++)
+        memcpy((unsigned char *)raw.data + (size_t)y * stride, bgr.ptr(y), stride);
+    cmd.record_clone(raw, upload, opt);
+
+    fp32.create(lb.w, lb.h, 3, 4u, 1, opt.blob_vkallocator);
+
+    std::vector<ncnn::VkMat> bindings(2);
+    bindings[0] = upload;
+    bindings[1] = fp32;
+
+    std::vector<ncnn::vk_constant_type> constants(12);
+    constants[0].i = lb.src_w;
+    constants[1].i = lb.src_h;
+    constants[2].i = stride;
+    constants[3].i = lb.rw;
+    constants[4].i = lb.rh;
+    constants[5].i = lb.pad_left;
+    constants[6].i = lb.pad_top;
+    constants[7].i = lb.w;
+    constants[8].i = lb.h;
+    constants[9].i = (int)fp32.cstep;
+    constants[10].f = (float)lb.src_w / lb.rw;
+    constants[11].f = (float)lb.src_h / lb.rh;
+
+    // one invocation per pixel writes all three planes
+    ncnn::VkMat dispatcher;
+    dispatcher.w = lb.w;
+    dispatcher.h = lb.h;
+    dispatcher.c = 1;
+    cmd.record_pipeline(pipeline, bindings, constants, dispatcher);
+
+    // Extractor::input() takes a VkMat as is, so it has to be in the net's
+    // storage type (fp16 unless disabled) and packing already, as
+    // record_upload() would leave a CPU input
+    const int elempack = !opt.use_packing_layout ? 1 : opt.use_shader_pack8 && fp32.c % 8 == 0 ? 8 : fp32.c % 4 == 0 ? 4 : 1;
+    vkdev->convert_packing(fp32, dst, elempack, cmd, opt);
+}
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include "net.h"
+
+// Letterbox geometry: the src_w x src_h frame is resized to rw x rh and
+// placed at (pad_left, pad_top) inside the w x h network input; the rest
+// is filled with 114 (before scaling to 0..1).
+struct Letterbox
+{
+    int src_w = 0, src_h = 0;
+    int rw = 0, rh = 0;
+    int pad_left = 0, pad_top = 0;
+    int w = 0, h = 0;
+};
+
+#if NCNN_VULKAN
+namespace ncnn {
+class Pipeline;
+class VulkanDevice;
+class VkMat;
+class VkCompute;
+} // namespace ncnn
+
+// Compute shader doing the whole CPU preprocessing chain of detect() in one
+// pass on the Vulkan device: bilinear resize of the uint8 BGR frame,
+// BGR->RGB, constant padding and 1/255 scaling, written as fp32 CHW and
+// then cast and packed for in0. The upload is the raw uint8 frame, which
+// for large frames is bigger than the float tensor; the gain is the CPU
+// time of the chain, not transfer size.
+class VulkanLetterbox
+{
+public:
+    VulkanLetterbox(const ncnn::VulkanDevice *vkdev, const ncnn::Option &opt);
+    ~VulkanLetterbox();
+
+    bool valid() const { return pipeline != 0; }
+
+    // Records upload and preprocessing of bgr (CV_8UC3) into dst on cmd,
+    // in opt's storage type and packing. raw, upload and fp32 hold the
+    // intermediates and must stay alive until cmd is submitted.
+    void record(ncnn::VkCompute &cmd, const cv::Mat &bgr, const Letterbox &lb, ncnn::Mat &raw, ncnn::VkMat &upload, ncnn::VkMat &fp32,
+                ncnn::VkMat &dst, const ncnn::Option &opt) const;
+
+private:
+    const ncnn::VulkanDevice *vkdev;
+    ncnn::Pipeline *pipeline = 0;
+};
+#endif
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include "incremental.h"
+
+IncrementalNcnnBackend::IncrementalNcnnBackend(const std::string &model_path, bool useVulkan, bool int8, int gpu_device, const std::string &stem_blob,
+                                               int stem_stride, int halo, int tile, float threshold, float max_changed)
+    : NcnnBackend(model_path, useVulkan, int8, gpu_device), stem_blob(stem_blob), stem_stride(stem_stride), halo(halo), tile(tile),
+      threshold(threshold), max_changed(max_changed)
+{
+}
+
+IncrementalNcnnBackend::~IncrementalNcnnBackend()
+{
+    if (frames > 0)
+        printf("[INFO] %s: %ld frames, %ld full runs, %ld of %ld tiles recomputed\n", name(), frames, full_runs, tiles_recomputed, tiles_total);
+}
+
+std::string IncrementalNcnnBackend::describe() const
+{
+    char buf[128];
+    snprintf(buf, sizeof(buf), " incremental stem=%s stride=%d halo=%d tile=%d threshold=%.3f", stem_blob.c_str(), stem_stride, halo, tile, threshold);
+    return NcnnBackend::describe() + buf;
+}
+
+int IncrementalNcnnBackend::full_run(const ncnn::Mat &in, std::vector<ncnn::Mat> &outs, int num_outputs)
+{
+    ncnn::Extractor ex = net.create_extractor();
+    ex.input("in0", in);
+    int ret = ex.extract(stem_blob.c_str(), stem);
+    outs.resize(num_outputs);
+    for (int i = 0; i < num_outputs && ret == 0; i++)
+        ret = ex.extract(("out" + std::to_string(i)).c_str(), outs[i]);
+    if (ret != 0)
+        return ret;
+
+    prev_in = in.clone();
+    cached = outs;
+    full_runs++;
+    return 0;
+}
+
+// Runs the stem on tiles [tx0, tx1) x [ty0, ty1) (in tile units) widened by
+// the halo and copies the exact interior back into the cached stem blob.
+void IncrementalNcnnBackend::recompute_run(const ncnn::Mat &in, int tx0, int tx1, int ty0, int ty1)
+{
+    const int x0 = tx0 * tile, x1 = std::min(in.w, tx1 * tile);
+    const int y0 = ty0 * tile, y1 = std::min(in.h, ty1 * tile);
+    const int cx0 = std::max(0, x0 - halo), cx1 = std::min(in.w, x1 + halo);
+    const int cy0 = std::max(0, y0 - halo), cy1 = std::min(in.h, y1 + halo);
+
+    ncnn::Mat crop(cx1 - cx0, cy1 - cy0, in.c);
+    for (int q = 0; q < in.c; q++)
+    {
+        for (int y = cy0; y < cy1; y++)
+            memcpy(crop.channel(q).row(y - cy0), in.channel(q).row(y) + cx0, (cx1 - cx0) * sizeof(float));
+    }
+
+    ncnn::Extractor ex = net.create_extractor();
+    ex.input("in0", crop);
+    ncnn::Mat part;
+    if (ex.extract(stem_blob.c_str(), part) != 0)
+        return;
+
+    const int s = stem_stride;
+    for (int q = 0; q < stem.c; q++)
+    {
+        for (int y = y0 / s; y < y1 / s; y++)
+            memcpy(stem.channel(q).row(y) + x0 / s, part.channel(q).row(y - cy0 / s) + (x0 - cx0) / s, (x1 - x0) / s * sizeof(float));
+    }
+
+    // the cache now reflects these pixels
+    for (int q = 0; q < in.c; q++)
+    {
+        for (int y = y0; y < y1; y++)
+            memcpy(prev_in.channel(q).row(y) + x0, in.channel(q).row(y) + x0, (x1 - x0) * sizeof(float));
+    }
+}
+
+int IncrementalNcnnBackend::infer(const ncnn::Mat &in, std::vector<ncnn::Mat> &outs, int num_outputs)
+{
+    frames++;
+    const int tiles_x = (in.w + tile - 1) / tile, tiles_y = (in.h + tile - 1) / tile;
+    tiles_total += tiles_x * tiles_y;
+
+    if (prev_in.empty() || prev_in.w != in.w || prev_in.h != in.h || prev_in.c != in.c || (int)cached.size() != num_outputs)
+    {
+        tiles_recomputed += tiles_x * tiles_y;
+        return full_run(in, outs, num_outputs);
+    }
+
+    // per-tile mean absolute difference over all channels
+    std::vector<float> diff(tiles_x * tiles_y, 0.f);
+    for (int q = 0; q < in.c; q++)
+    {
+        for (int y = 0; y < in.h; y++)
+        {
+            const float *a = in.channel(q).row(y);
+            const float *b = prev_in.channel(q).row(y);
+            float *d = &diff[(y / tile) * tiles_x];
+            for (int x = 0; x < in.w; x++)
+                d[x / tile] += fabsf(a[x] - b[x]);
+        }
+    }
+
+    std::vector<char> changed(tiles_x * tiles_y);
+    int num_changed = 0;
+    for (int t = 0; t < tiles_x * tiles_y; t++)
+    {
+        const int tw = std::min(tile, in.w - (t % tiles_x) * tile), th = std::min(tile, in.h - (t / tiles_x) * tile);
+        changed[t] = diff[t] / (tw * th * in.c) > threshold;
+        num_changed += changed[t];
+    }
+    tiles_recomputed += num_changed;
+
+    if (num_changed == 0)
+    {
+        outs = cached;
+        return 0;
+    }
+    if (num_changed > max_changed * tiles_x * tiles_y)
+        return full_run(in, outs, num_outputs);
+
+    // consecutive changed tiles of a row share one stem pass
+    for (int ty = 0; ty < tiles_y; ty++)
+    {
+        for (int tx = 0; tx < tiles_x;)
+        {
+            if (!changed[ty * tiles_x + tx])
+            {
+                tx++;
+                continue;
+            }
+            int end = tx;
+            while (end < tiles_x && changed[ty * tiles_x + end])
+                end++;
+            recompute_run(in, tx, end, ty, ty + 1);
+            tx = end;
+        }
+    }
+
+    ncnn::Extractor ex = net.create_extractor();
+    ex.input(stem_blob.c_str(), stem);
+    outs.resize(num_outputs);
+    for (int i = 0; i < num_outputs; i++)
+    {
+        int ret = ex.extract(("out" + std::to_string(i)).c_str(), outs[i]);
+        if (ret != 0)
+            return ret;
+    }
+    cached = outs;
+    return 0;
+}
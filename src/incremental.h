@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "backend.h"
+
+// Experimental ncnn backend for fixed cameras. The letterboxed input is
+// split into tiles aligned to the network stride; tiles whose pixels did
+// not change since the last frame keep their cached stem activations and
+// only changed tiles (plus a halo covering the stem's receptive field) are
+// pushed through the stem layers. The rest of the network then starts from
+// the patched stem blob. A frame with no changed tile returns the previous
+// outputs unchanged.
+class IncrementalNcnnBackend : public NcnnBackend
+{
+public:
+    // stem_blob: last blob of the reused layers, stem_stride: its stride
+    // relative to in0, halo: input pixels recomputed around each changed
+    // tile (>= half the stem's receptive field, multiple of stem_stride),
+    // threshold: mean absolute change of a tile's normalized pixels
+    IncrementalNcnnBackend(const std::string &model_path, bool useVulkan = true, bool int8 = false, int gpu_device = -1, const std::string &stem_blob = "4",
+                           int stem_stride = 4, int halo = 8, int tile = 32, float threshold = 0.02f, float max_changed = 0.6f);
+    ~IncrementalNcnnBackend();
+
+    const char *name() const { return "ncnn-incremental"; }
+    std::string describe() const;
+    int infer(const ncnn::Mat &in, std::vector<ncnn::Mat> &outs, int num_outputs);
+    // change detection needs the preprocessed input on the CPU
+    bool accepts_bgr() const { return false; }
+
+private:
+    int full_run(const ncnn::Mat &in, std::vector<ncnn::Mat> &outs, int num_outputs);
+    void recompute_run(const ncnn::Mat &in, int tx0, int tx1, int ty0, int ty1);
+
+    std::string stem_blob;
+    int stem_stride, halo, tile;
+    float threshold, max_changed;
+
+    ncnn::Mat prev_in;             // input the cache corresponds to
+    ncnn::Mat stem;                // cached stem activations
+    std::vector<ncnn::Mat> cached; // outputs of the last frame
+
+    long frames = 0, full_runs = 0, tiles_total = 0, tiles_recomputed = 0;
+};
@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <errno.h>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "async_io.h"
+#include "ingest.h"
+#include "jpeg_stream.h"
+
+static bool is_image(const std::string &path)
+{
+    std::string ext = path.substr(path.find_last_of('.') + 1);
+    for (auto &c : ext)
+        c = tolower(c);
+    return ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "bmp";
+}
+
+// name without directory and extension
+static std::string stem(const std::string &path)
+{
+    size_t slash = path.find_last_of('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    return name.substr(0, name.find_last_of('.'));
+}
+
+// modification time in ns, -1 when path does not exist
+static long long mtime_ns(const std::string &path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return -1;
+    return st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+static std::string json_quote(const std::string &s)
+{
+    std::string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+// One line: {"file":...,"mtime":N,"width":W,"height":H,"objects":[{"label":0,"name":"person","score":0.912,"box":[x,y,w,h]},...]}
+// objects are in coordinates of an image scale_x, scale_y times smaller than size
+static std::string result_json(const std::string &path, long long mtime, cv::Size size, const std::vector<Object> &objects,
+                               float scale_x, float scale_y, const std::vector<std::string> &names)
+{
+    char buf[192];
+    snprintf(buf, sizeof(buf), ",\"mtime\":%lld,\"width\":%d,\"height\":%d,\"objects\":[", mtime, size.width, size.height);
+    std::string out = "{\"file\":" + json_quote(path) + buf;
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        const Object &obj = objects[i];
+        const float x0 = std::max(obj.rect.x * scale_x, 0.f);
+        const float y0 = std::max(obj.rect.y * scale_y, 0.f);
+        const float x1 = std::min(obj.rect.br().x * scale_x, size.width - 1.f);
+        const float y1 = std::min(obj.rect.br().y * scale_y, size.height - 1.f);
+        snprintf(buf, sizeof(buf), "%s{\"label\":%d,", i ? "," : "", obj.label);
+        out += buf;
+        if (obj.label >= 0 && obj.label < (int)names.size())
+            out += "\"name\":" + json_quote(names[obj.label]) + ",";
+        snprintf(buf, sizeof(buf), "\"score\":%.3f,\"box\":[%.1f,%.1f,%.1f,%.1f]}", obj.prob, x0, y0, x1 - x0, y1 - y0);
+        out += buf;
+    }
+    return out + "]}\n";
+}
+
+// file -> mtime of the records in a sink written by result_json(), the
+// latest record of a file wins
+static std::map<std::string, long long> read_sink(const std::string &path)
+{
+    std::map<std::string, long long> done;
+    std::ifstream in(path);
+    for (std::string line; std::getline(in, line);)
+    {
+        if (line.compare(0, 9, "{\"file\":\"") != 0)
+            continue;
+        std::string file;
+        size_t pos = 9;
+        for (; pos < line.size() && line[pos] != '"'; pos++)
+        {
+            char c = line[pos];
+            if (c == '\\' && pos + 1 < line.size())
+            {
+                c = line[++pos];
+                if (c == 'u' && pos + 4 < line.size())
+                {
+                    c = (char)strtol(line.substr(pos + 1, 4).c_str(), 0, 16);
+                    pos += 4;
+                }
+            }
+            file += c;
+        }
+        if (pos < line.size() && line.compare(pos + 1, 9, ",\"mtime\":") == 0)
+            done[file] = atoll(line.c_str() + pos + 10);
+    }
+    return done;
+}
+
+int process_directory(YoloV11 &yolo, const std::string &dir, const IngestOptions &opt)
+{
+    std::vector<cv::String> all;
+    cv::glob(dir, all, false);
+    std::vector<std::string> files;
+    for (const auto &f : all)
+        if (is_image(f))
+            files.push_back(f);
+    if (files.empty())
+    {
+        fprintf(stderr, "No images found in %s\n", dir.c_str());
+        return -1;
+    }
+    if (mkdir(opt.out_dir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Cannot create %s: %s\n", opt.out_dir.c_str(), strerror(errno));
+        return -1;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    double read_wait_ms = 0, detect_ms = 0;
+    int processed = 0;
+    {
+        // reads and writes share the queue; writes block once it is full
+        AsyncFileIO io(opt.prefetch * 2);
+        printf("[INGEST] %zu files from %s, io=%s, prefetch=%d\n", files.size(), dir.c_str(), io.backend(), opt.prefetch);
+
+        std::deque<std::future<std::vector<unsigned char>>> reads;
+        size_t next = 0;
+        while (next < files.size() && (int)reads.size() < opt.prefetch)
+            reads.push_back(io.read(files[next++]));
+
+        std::vector<Object> objects;
+        const std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, opt.jpeg_quality};
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            std::vector<unsigned char> bytes = reads.front().get();
+            reads.pop_front();
+            auto t1 = std::chrono::high_resolution_clock::now();
+            read_wait_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+            if (next < files.size())
+                reads.push_back(io.read(files[next++]));
+
+            cv::Mat img;
+            cv::Size full;
+            if (bytes.empty() || !(opt.stream_decode && decode_jpeg_fit(bytes.data(), bytes.size(), TARGET_SIZE, img, full)))
+                img = bytes.empty() ? cv::Mat() : cv::imdecode(bytes, cv::IMREAD_COLOR);
+            if (img.empty())
+            {
+                fprintf(stderr, "[WARN] Cannot decode %s\n", files[i].c_str());
+                continue;
+            }
+
+            auto t2 = std::chrono::high_resolution_clock::now();
+            yolo.detect(img, objects);
+            auto t3 = std::chrono::high_resolution_clock::now();
+            detect_ms += std::chrono::duration<double, std::milli>(t3 - t2).count();
+
+            std::vector<unsigned char> jpg;
+            cv::imencode(".jpg", yolo.render_result(img, objects, opt.preview_size), jpg, params);
+            io.write(opt.out_dir + "/" + stem(files[i]) + ".jpg", std::move(jpg));
+            processed++;
+            printf("[INGEST] %s: %zu objects\n", files[i].c_str(), objects.size());
+        }
+        // leaving the scope waits for the last writes
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    const double total_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    printf("[INGEST] %d images in %.1f ms (%.1f fps), detect %.1f ms, waiting for reads %.1f ms, results in %s\n", processed, total_ms,
+           processed * 1000.0 / total_ms, detect_ms, read_wait_ms, opt.out_dir.c_str());
+    return 0;
+}
+
+int watch_directory(HeteroScheduler &sched, const std::vector<std::string> &names, const std::string &watch_dir, const WatchOptions &opt)
+{
+    std::string dir = watch_dir;
+    while (dir.size() > 1 && dir.back() == '/')
+        dir.pop_back();
+
+    // watch before listing, so a file arriving in between is not missed
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        fprintf(stderr, "Cannot watch %s: %s\n", dir.c_str(), strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    FILE *sink = 0;
+    if (opt.sink == "-")
+    {
+        sink = stdout;
+    }
+    else if (!opt.sink.empty() && !(sink = fopen(opt.sink.c_str(), "a")))
+    {
+        fprintf(stderr, "Cannot open %s: %s\n", opt.sink.c_str(), strerror(errno));
+        close(fd);
+        return -1;
+    }
+    std::mutex sink_mutex;
+
+    AsyncFileIO io(opt.max_batch * 2);
+
+    // images without an up to date result; with a file sink the results
+    // are its records, stdout keeps none
+    auto list_pending = [&]() {
+        std::map<std::string, long long> done;
+        if (sink && sink != stdout)
+        {
+            std::lock_guard<std::mutex> lock(sink_mutex);
+            done = read_sink(opt.sink);
+        }
+        std::vector<cv::String> all;
+        cv::glob(dir, all, false);
+        std::vector<std::string> files;
+        for (const auto &f : all)
+        {
+            const long long t = is_image(f) ? mtime_ns(f) : -1;
+            if (t < 0)
+                continue;
+            if (sink)
+            {
+                auto it = done.find(f);
+                if (it != done.end() && it->second == t)
+                    continue;
+            }
+            else if (mtime_ns(f + ".json") >= t)
+            {
+                continue;
+            }
+            files.push_back(f);
+        }
+        return files;
+    };
+
+    // all reads of a batch are issued together, frames go to the pool as
+    // they are decoded and the batch ends when the pool is idle again
+    int batches = 0;
+    long long images = 0;
+    auto process = [&](const std::vector<std::string> &batch) {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        std::vector<long long> mtimes;
+        std::vector<std::future<std::vector<unsigned char>>> reads;
+        for (const auto &f : batch)
+        {
+            mtimes.push_back(mtime_ns(f));
+            reads.push_back(io.read(f));
+        }
+
+        int submitted = 0;
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            std::vector<unsigned char> bytes = reads[i].get();
+            cv::Mat img;
+            cv::Size full;
+            const bool fitted = !bytes.empty() && opt.stream_decode && decode_jpeg_fit(bytes.data(), bytes.size(), TARGET_SIZE, img, full);
+            if (!fitted && !bytes.empty())
+                img = cv::imdecode(bytes, cv::IMREAD_COLOR);
+            if (img.empty())
+            {
+                fprintf(stderr, "[WARN] Cannot decode %s\n", batch[i].c_str());
+                continue;
+            }
+
+            const std::string path = batch[i];
+            const long long mtime = mtimes[i];
+            const cv::Size size = fitted ? full : img.size();
+            const float scale_x = (float)size.width / img.cols;
+            const float scale_y = (float)size.height / img.rows;
+            sched.submit(img, [&, path, mtime, size, scale_x, scale_y](int, const std::vector<Object> &objects) {
+                std::string json = result_json(path, mtime, size, objects, scale_x, scale_y, names);
+                if (sink)
+                {
+                    std::lock_guard<std::mutex> lock(sink_mutex);
+                    fputs(json.c_str(), sink);
+                    fflush(sink);
+                }
+                else
+                {
+                    io.write(path + ".json", std::vector<unsigned char>(json.begin(), json.end()));
+                }
+            });
+            submitted++;
+        }
+        sched.drain();
+
+        batches++;
+        images += submitted;
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+        printf("[WATCH] batch %d: %d images in %.1f ms (%.1f fps), %lld images so far\n", batches, submitted, ms,
+               submitted * 1000.0 / std::max(ms, 1e-3), images);
+        fflush(stdout);
+    };
+
+    std::vector<std::string> batch = list_pending();
+    printf("[WATCH] %s: %zu images waiting, io=%s, results %s\n", dir.c_str(), batch.size(), io.backend(),
+           sink ? (opt.sink == "-" ? "to stdout" : ("appended to " + opt.sink).c_str()) : "next to each image as <file>.json");
+    fflush(stdout);
+
+    int ret = 0;
+    alignas(inotify_event) char buf[64 * 1024];
+    for (;;)
+    {
+        while ((int)batch.size() >= opt.max_batch)
+        {
+            process(std::vector<std::string>(batch.begin(), batch.begin() + opt.max_batch));
+            batch.erase(batch.begin(), batch.begin() + opt.max_batch);
+        }
+
+        // a batch closes after batch_ms without a new file
+        pollfd p = {fd, POLLIN, 0};
+        const int n = poll(&p, 1, batch.empty() ? -1 : opt.batch_ms);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            fprintf(stderr, "[ERROR] poll failed: %s\n", strerror(errno));
+            ret = -1;
+            break;
+        }
+        if (n == 0)
+        {
+            process(batch);
+            batch.clear();
+            continue;
+        }
+
+        const ssize_t len = read(fd, buf, sizeof(buf));
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0)
+        {
+            fprintf(stderr, "[ERROR] inotify read failed: %s\n", strerror(errno));
+            ret = -1;
+            break;
+        }
+        bool overflow = false, removed = false;
+        for (char *q = buf; q < buf + len;)
+        {
+            const inotify_event *ev = (const inotify_event *)q;
+            q += sizeof(inotify_event) + ev->len;
+            overflow |= (ev->mask & IN_Q_OVERFLOW) != 0;
+            removed |= (ev->mask & IN_IGNORED) != 0;
+            if (!ev->len || !is_image(ev->name))
+                continue;
+            const std::string path = dir + "/" + ev->name;
+            if (std::find(batch.begin(), batch.end(), path) == batch.end())
+                batch.push_back(path);
+        }
+        if (removed)
+        {
+            fprintf(stderr, "[ERROR] %s is gone\n", dir.c_str());
+            ret = -1;
+            break;
+        }
+        if (overflow)
+        {
+            // events were lost, fall back to the directory listing
+            fprintf(stderr, "[WARN] inotify queue overflow, rescanning %s\n", dir.c_str());
+            for (const auto &f : list_pending())
+                if (std::find(batch.begin(), batch.end(), f) == batch.end())
+                    batch.push_back(f);
+        }
+    }
+
+    if (sink && sink != stdout)
+        fclose(sink);
+    close(fd);
+    return ret;
+}
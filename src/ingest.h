@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "scheduler.h"
+#include "yolo11.h"
+
+struct IngestOptions
+{
+    std::string out_dir = "results"; // annotated images, <name>.jpg
+    bool stream_decode = false;      // see jpeg_stream.h, results are then drawn at input size
+    int preview_size = 0;            // as in save_result()
+    int prefetch = 8;                // files read ahead of the detector
+    int jpeg_quality = 90;
+};
+
+// Runs the detector over every image in dir. Reads are queued prefetch
+// files ahead and the annotated results are written behind it through
+// AsyncFileIO, so the detector only waits for storage when it outruns it.
+int process_directory(YoloV11 &yolo, const std::string &dir, const IngestOptions &opt);
+
+struct WatchOptions
+{
+    std::string sink;          // empty: <file>.json next to each image, "-": stdout, else JSON lines appended to it
+    bool stream_decode = false; // see jpeg_stream.h
+    int batch_ms = 200;        // a batch closes once no new file arrived for this long
+    int max_batch = 32;        // ... or when it holds this many files
+};
+
+// Watches dir (inotify, files closed after writing or moved in) and runs
+// every new image through the detector pool, writing one JSON record of
+// boxes in image coordinates per file. Bursts are coalesced into batches
+// whose files are read together and submitted back to back. Images already
+// there at startup are processed first, except those with an up to date
+// result: a <file>.json, or a sink record carrying the image's mtime; the
+// same rescan runs if the event queue overflows. With the stdout sink there
+// is nothing to check, so a restart processes the whole directory again.
+// No per-file state is kept in memory. Runs until killed.
+int watch_directory(HeteroScheduler &sched, const std::vector<std::string> &names, const std::string &dir, const WatchOptions &opt);
@@ -0,0 +1,224 @@
+#include "jpeg_stream.h"
+
+#if YOLONCNN_JPEG
+#include <algorithm>
+#include <memory>
+#include <setjmp.h>
+#include <stdio.h>
+#include <vector>
+#include <jpeglib.h>
+
+struct JpegError
+{
+    jpeg_error_mgr mgr;
+    jmp_buf jump;
+};
+
+static void on_jpeg_error(j_common_ptr cinfo)
+{
+    longjmp(((JpegError *)cinfo->err)->jump, 1);
+}
+
+// letterbox resize size of detect()
+static void fit_size(int w, int h, int target_size, int &ow, int &oh)
+{
+    const float scale = (w > h) ? (float)target_size / w : (float)target_size / h;
+    ow = w * scale;
+    oh = h * scale;
+    if (ow > oh)
+        ow = target_size;
+    else
+        oh = target_size;
+}
+
+// Source pixel src adds weight w of itself to output pixel dst
+struct AreaTap
+{
+    int src, dst;
+    float w;
+};
+
+// Area (INTER_AREA) weights shrinking src pixels to dst <= src pixels. Each
+// source pixel overlaps one or two output pixels; the list is ordered by
+// both src and dst.
+static std::vector<AreaTap> area_taps(int src, int dst)
+{
+    std::vector<AreaTap> taps;
+    const double f = (double)src / dst;
+    for (int d = 0; d < dst; d++)
+    {
+        const double b = d * f, e = (d + 1) * f;
+        for (int s = (int)b; s < src && s < e; s++)
+        {
+            const double w = std::min(e, s + 1.0) - std::max(b, (double)s);
+            if (w > 1e-6)
+                taps.push_back({s, d, (float)(w / f)});
+        }
+    }
+    return taps;
+}
+
+// Resizes scanlines pushed in order into out. Only the horizontally
+// resized row and two output row accumulators are kept.
+struct RowResizer
+{
+    std::vector<AreaTap> xtaps, ytaps;
+    std::vector<int> last_src; // per output row, the source row completing it
+    std::vector<float> hrow, acc[2];
+    std::vector<unsigned char> batch;  // scanlines from the decoder
+    std::vector<JSAMPROW> batch_rows;
+    size_t next_ytap = 0;
+    bool swap_rb = false;
+
+    void setup(int sw, int sh, int dw, int dh)
+    {
+        xtaps = area_taps(sw, dw);
+        ytaps = area_taps(sh, dh);
+        last_src.assign(dh, 0);
+        for (const AreaTap &t : ytaps)
+            last_src[t.dst] = t.src;
+        hrow.assign(dw * 3, 0.f);
+        acc[0].assign(dw * 3, 0.f);
+        acc[1].assign(dw * 3, 0.f);
+        next_ytap = 0;
+    }
+
+    void push(const unsigned char *row, int sy, cv::Mat &out)
+    {
+        std::fill(hrow.begin(), hrow.end(), 0.f);
+        for (const AreaTap &t : xtaps)
+        {
+            const unsigned char *p = row + t.src * 3;
+            float *q = &hrow[t.dst * 3];
+            q[0] += t.w * p[0];
+            q[1] += t.w * p[1];
+            q[2] += t.w * p[2];
+        }
+
+        const int n = hrow.size();
+        for (; next_ytap < ytaps.size() && ytaps[next_ytap].src == sy; next_ytap++)
+        {
+            const AreaTap &t = ytaps[next_ytap];
+            float *a = acc[t.dst & 1].data();
+            for (int i = 0; i < n; i++)
+                a[i] += t.w * hrow[i];
+            if (last_src[t.dst] != sy)
+                continue;
+
+            unsigned char *o = out.ptr(t.dst);
+            for (int i = 0; i < n; i += 3)
+            {
+                o[i] = cv::saturate_cast<unsigned char>(a[swap_rb ? i + 2 : i]);
+                o[i + 1] = cv::saturate_cast<unsigned char>(a[i + 1]);
+                o[i + 2] = cv::saturate_cast<unsigned char>(a[swap_rb ? i : i + 2]);
+            }
+            std::fill(a, a + n, 0.f);
+        }
+    }
+};
+
+// src installs the data source on the decompressor. All C++ state lives
+// behind a pointer set before setjmp, so a longjmp out of the decoder
+// skips no destructors.
+template <typename Src>
+static bool decode_fit(Src src, int target_size, cv::Mat &out, cv::Size &full_size)
+{
+    jpeg_decompress_struct cinfo;
+    JpegError err;
+    std::unique_ptr<RowResizer> resizer(new RowResizer);
+
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = on_jpeg_error;
+    if (setjmp(err.jump))
+    {
+        jpeg_destroy_decompress(&cinfo);
+        out.release();
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    src(&cinfo);
+    jpeg_read_header(&cinfo, TRUE);
+
+    const int w = cinfo.image_width, h = cinfo.image_height;
+    int ow, oh;
+    fit_size(w, h, target_size, ow, oh);
+    if (ow >= w || oh >= h)
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+#ifdef JCS_EXTENSIONS
+    cinfo.out_color_space = JCS_EXT_BGR;
+#else
+    cinfo.out_color_space = JCS_RGB;
+    resizer->swap_rb = true;
+#endif
+    // largest DCT reduction that still leaves at least ow x oh
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = 1;
+    for (int denom = 8; denom >= 2; denom /= 2)
+    {
+        if ((w + denom - 1) / denom >= ow && (h + denom - 1) / denom >= oh)
+        {
+            cinfo.scale_denom = denom;
+            break;
+        }
+    }
+    jpeg_start_decompress(&cinfo);
+    if (cinfo.output_components != 3)
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    const int dw = cinfo.output_width, dh = cinfo.output_height;
+    resizer->setup(dw, dh, ow, oh);
+    out.create(oh, ow, CV_8UC3);
+
+    // the decoder hands out up to rec_outbuf_height rows per call
+    const int batch = std::max(cinfo.rec_outbuf_height, 4);
+    resizer->batch.resize((size_t)batch * dw * 3);
+    resizer->batch_rows.resize(batch);
+    for (int i = 0; i < batch; i++)
+        resizer->batch_rows[i] = resizer->batch.data() + (size_t)i * dw * 3;
+
+    while ((int)cinfo.output_scanline < dh)
+    {
+        const int first = cinfo.output_scanline;
+        const int n = jpeg_read_scanlines(&cinfo, resizer->batch_rows.data(), batch);
+        for (int i = 0; i < n; i++)
+            resizer->push(resizer->batch_rows[i], first + i, out);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    full_size = cv::Size(w, h);
+    return true;
+}
+
+bool decode_jpeg_fit(const unsigned char *data, size_t size, int target_size, cv::Mat &out, cv::Size &full_size)
+{
+    return decode_fit([&](j_decompress_ptr cinfo) { jpeg_mem_src(cinfo, (unsigned char *)data, size); }, target_size, out, full_size);
+}
+
+bool read_jpeg_fit(const std::string &path, int target_size, cv::Mat &out, cv::Size &full_size)
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp)
+        return false;
+    bool ok = decode_fit([&](j_decompress_ptr cinfo) { jpeg_stdio_src(cinfo, fp); }, target_size, out, full_size);
+    fclose(fp);
+    return ok;
+}
+#else
+bool decode_jpeg_fit(const unsigned char *, size_t, int, cv::Mat &, cv::Size &)
+{
+    return false;
+}
+
+bool read_jpeg_fit(const std::string &, int, cv::Mat &, cv::Size &)
+{
+    return false;
+}
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+// Streaming JPEG decode for large inputs. libjpeg first shrinks by its DCT
+// scaling (1/2, 1/4, 1/8) as far as the result stays at least the target
+// size. Scanline batches are then area-resized into the output as they
+// come out of the decoder. The output is the size detect() resizes to
+// (longer side target_size), so detect() does no resize of its own, and
+// a 12 MP frame never exists at full resolution: memory is the output
+// plus a few rows.
+//
+// full_size receives the original dimensions, for mapping detections back
+// (DetectionSet::remap(0, 0, out.cols / (float)full_size.width,
+// out.rows / (float)full_size.height, ...); each side is truncated on its
+// own, so the two scales differ slightly).
+// Returns false (and the caller decodes normally) when built without
+// libjpeg, for images no larger than the target, and for anything libjpeg
+// cannot convert to BGR.
+bool decode_jpeg_fit(const unsigned char *data, size_t size, int target_size, cv::Mat &out, cv::Size &full_size);
+bool read_jpeg_fit(const std::string &path, int target_size, cv::Mat &out, cv::Size &full_size);
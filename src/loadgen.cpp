@@ -0,0 +1,218 @@
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include "benchmark.h"
+#include "loadgen.h"
+#include "server.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// JPEG payloads held in memory so encoding never sits on the send path
+static std::vector<std::vector<uchar>> load_payloads(const std::string &source)
+{
+    std::vector<std::vector<uchar>> payloads;
+    if (std::filesystem::is_directory(source))
+    {
+        std::vector<cv::String> files;
+        cv::glob(source, files, false);
+        for (const auto &f : files)
+        {
+            std::string ext = std::filesystem::path(f).extension().string();
+            if (ext != ".jpg" && ext != ".jpeg" && ext != ".JPG")
+                continue;
+            std::ifstream in(f, std::ios::binary);
+            payloads.emplace_back((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        }
+    }
+    else
+    {
+        cv::VideoCapture cap(source);
+        cv::Mat frame;
+        while ((int)payloads.size() < 300 && cap.read(frame))
+        {
+            payloads.emplace_back();
+            cv::imencode(".jpg", frame, payloads.back());
+        }
+    }
+    return payloads;
+}
+
+// host is a name or an IPv4/IPv6 literal; every resolved address is tried
+static int connect_to(const std::string &host, int port)
+{
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = 0;
+    const int err = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res);
+    if (err != 0)
+    {
+        fprintf(stderr, "Cannot resolve %s: %s\n", host.c_str(), gai_strerror(err));
+        return -1;
+    }
+    int fd = -1;
+    for (addrinfo *a = res; a && fd < 0; a = a->ai_next)
+    {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (fd < 0)
+        return -1;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+namespace {
+
+struct Stream
+{
+    int fd = -1;
+    std::mutex lock;
+    std::deque<std::pair<Clock::time_point, Clock::time_point>> in_flight; // scheduled, sent
+    int sent = 0;
+    std::vector<double> corrected_ms, raw_ms;
+};
+
+} // namespace
+
+// counts per power-of-two latency bucket, side by side
+static void print_histogram(const std::vector<double> &corrected, const std::vector<double> &raw)
+{
+    printf("[LOAD] %-16s %10s %10s\n", "latency ms", "corrected", "raw");
+    double lo = 0, hi = 1;
+    while (true)
+    {
+        int c = 0, r = 0;
+        for (double v : corrected)
+            c += v >= lo && v < hi;
+        for (double v : raw)
+            r += v >= lo && v < hi;
+        printf("[LOAD] [%6.0f, %6.0f) %10d %10d\n", lo, hi, c, r);
+        bool more = false;
+        for (double v : corrected)
+            more |= v >= hi;
+        if (!more)
+            break;
+        lo = hi;
+        hi *= 2;
+    }
+}
+
+int run_loadgen(const LoadOptions &opt)
+{
+    std::vector<std::vector<uchar>> payloads = load_payloads(opt.source);
+    if (payloads.empty())
+    {
+        fprintf(stderr, "No frames found: %s\n", opt.source.c_str());
+        return -1;
+    }
+
+    std::vector<Stream> streams(opt.streams);
+    for (auto &s : streams)
+    {
+        s.fd = connect_to(opt.host, opt.port);
+        if (s.fd < 0)
+        {
+            fprintf(stderr, "Failed to connect to %s:%d\n", opt.host.c_str(), opt.port);
+            return -1;
+        }
+    }
+
+    printf("[LOAD] %d streams x %.2f req/s (%s arrivals) for %.0f s, %zu frames\n", opt.streams, opt.rate,
+           opt.poisson ? "poisson" : "constant", opt.duration, payloads.size());
+
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point end = start + std::chrono::microseconds((int64_t)(opt.duration * 1e6));
+    std::vector<std::thread> threads;
+    for (int si = 0; si < opt.streams; si++)
+    {
+        threads.emplace_back([&, si]() {
+            Stream &s = streams[si];
+            std::mt19937 rng(1234 + si);
+            std::exponential_distribution<double> gap(opt.rate);
+            std::uniform_real_distribution<double> phase(0, 1.0 / opt.rate);
+            // staggered start so constant-rate streams do not fire in lockstep
+            double t = phase(rng);
+            for (int k = 0;; k++)
+            {
+                Clock::time_point scheduled = start + std::chrono::microseconds((int64_t)(t * 1e6));
+                if (scheduled >= end)
+                    break;
+                std::this_thread::sleep_until(scheduled);
+
+                const std::vector<uchar> &p = payloads[(si * 7 + k) % payloads.size()];
+                uint32_t size = p.size();
+                {
+                    std::lock_guard<std::mutex> lk(s.lock);
+                    s.in_flight.emplace_back(scheduled, Clock::now());
+                    s.sent++;
+                }
+                if (!write_full(s.fd, &size, sizeof(size)) || !write_full(s.fd, p.data(), size))
+                    break;
+                t += opt.poisson ? gap(rng) : 1.0 / opt.rate;
+            }
+            // the server answers everything already queued, then sees EOF
+            // and closes, which ends the receiver below
+            shutdown(s.fd, SHUT_WR);
+        });
+
+        threads.emplace_back([&, si]() {
+            Stream &s = streams[si];
+            std::vector<WireDetection> dets;
+            for (;;)
+            {
+                uint32_t count = 0;
+                if (!read_full(s.fd, &count, sizeof(count)))
+                    break;
+                dets.resize(count);
+                if (count > 0 && !read_full(s.fd, dets.data(), count * sizeof(WireDetection)))
+                    break;
+
+                Clock::time_point now = Clock::now();
+                std::lock_guard<std::mutex> lk(s.lock);
+                if (s.in_flight.empty())
+                    continue;
+                auto sent = s.in_flight.front();
+                s.in_flight.pop_front();
+                s.corrected_ms.push_back(std::chrono::duration<double, std::milli>(now - sent.first).count());
+                s.raw_ms.push_back(std::chrono::duration<double, std::milli>(now - sent.second).count());
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+    const double wall_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    int sent = 0;
+    std::vector<double> corrected, raw;
+    for (auto &s : streams)
+    {
+        close(s.fd);
+        sent += s.sent;
+        corrected.insert(corrected.end(), s.corrected_ms.begin(), s.corrected_ms.end());
+        raw.insert(raw.end(), s.raw_ms.begin(), s.raw_ms.end());
+    }
+
+    StageStats c = compute_stats(corrected), r = compute_stats(raw);
+    printf("[LOAD] sent=%d completed=%zu offered=%.1f req/s throughput=%.1f req/s\n", sent, corrected.size(), opt.streams * opt.rate,
+           wall_s > 0 ? corrected.size() / wall_s : 0.0);
+    printf("[LOAD] corrected ms: mean=%.2f p50=%.2f p90=%.2f p99=%.2f max=%.2f\n", c.mean, c.p50, c.p90, c.p99, c.max);
+    printf("[LOAD] raw ms:       mean=%.2f p50=%.2f p90=%.2f p99=%.2f max=%.2f\n", r.mean, r.p50, r.p90, r.p99, r.max);
+    print_histogram(corrected, raw);
+    return 0;
+}
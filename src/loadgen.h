@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+struct LoadOptions
+{
+    std::string host = "127.0.0.1";
+    int port = 5555;
+    std::string source;  // image directory or video file
+    int streams = 4;     // simulated cameras, one connection each
+    double rate = 5;     // requests per second per stream
+    bool poisson = true; // exponential gaps, otherwise constant
+    double duration = 30; // seconds
+};
+
+// Open-loop load: every stream sends on its own schedule whether or not
+// earlier responses have arrived. Latency is measured from the scheduled
+// send time (corrected for coordinated omission) and, for comparison, from
+// the actual send time.
+int run_loadgen(const LoadOptions &opt);
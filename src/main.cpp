@@ -0,0 +1,463 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string.h>
+#include <sys/stat.h>
+#include <opencv2/opencv.hpp>
+#include "yolo11.h"
+#include "stage2.h"
+#include "benchmark.h"
+#include "trace.h"
+#include "server.h"
+#include "loadgen.h"
+#include "model_tools.h"
+#include "scheduler.h"
+#include "downscale.h"
+#include "jpeg_stream.h"
+#include "ingest.h"
+#include "event_clip.h"
+#include "delta_stream.h"
+
+// "--key=value" options may appear anywhere after the program name,
+// everything else is positional
+static std::string get_option(int argc, char **argv, const std::string &key, const std::string &def = "")
+{
+    const std::string prefix = "--" + key + "=";
+    for (int i = 1; i < argc; i++)
+        if (strncmp(argv[i], prefix.c_str(), prefix.size()) == 0)
+            return argv[i] + prefix.size();
+    return def;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<char *> args;
+    for (int i = 0; i < argc; i++)
+        if (strncmp(argv[i], "--", 2) != 0)
+            args.push_back(argv[i]);
+
+    std::string record_dir = get_option(argc, argv, "record");
+    if (!record_dir.empty())
+    {
+        return record_trace(get_option(argc, argv, "source", "0"), record_dir, std::stoi(get_option(argc, argv, "frames", "0")),
+                            std::stoi(get_option(argc, argv, "record-ref", "0")));
+    }
+
+    std::string compare = get_option(argc, argv, "compare");
+    if (!compare.empty())
+    {
+        size_t comma = compare.find(',');
+        if (comma == std::string::npos)
+        {
+            fprintf(stderr, "--compare expects base.json,new.json\n");
+            return -1;
+        }
+        int regressions = compare_benchmarks(compare.substr(0, comma), compare.substr(comma + 1), std::stod(get_option(argc, argv, "threshold", "2")));
+        return regressions != 0 ? 1 : 0;
+    }
+
+    std::string loadgen = get_option(argc, argv, "loadgen");
+    if (!loadgen.empty())
+    {
+        LoadOptions opt;
+        size_t colon = loadgen.rfind(':');
+        opt.host = loadgen.substr(0, colon);
+        if (colon != std::string::npos)
+            opt.port = std::stoi(loadgen.substr(colon + 1));
+        opt.source = get_option(argc, argv, "source", "data/calib_imgs");
+        opt.streams = std::stoi(get_option(argc, argv, "streams", "4"));
+        opt.rate = std::stod(get_option(argc, argv, "rate", "5"));
+        opt.poisson = get_option(argc, argv, "arrival", "poisson") == "poisson";
+        opt.duration = std::stod(get_option(argc, argv, "duration", "30"));
+        return run_loadgen(opt);
+    }
+
+    if (args.size() < 3)
+    {
+        printf("Usage: %s [imagepath] [modelpath] [int8=0/1] [conf=0.25] [nms=0.45]\n", argv[0]);
+        printf("       imagepath may be a directory: every image is annotated into --out-dir\n");
+        printf("       %s --record=tracedir [--source=0] [--frames=0] [--record-ref=0/1]\n", argv[0]);
+        printf("       %s --compare=base.json,new.json [--threshold=2]\n", argv[0]);
+        printf("       %s --loadgen=host:port [--source=data/calib_imgs] [--streams=4] [--rate=5] [--arrival=poisson|constant] [--duration=30]\n", argv[0]);
+        printf("Options:\n");
+        printf("  --task=detect         detect | segment | pose | obb\n");
+        printf("  --gpu=auto            auto | software | off | Vulkan device index\n");
+        printf("  --vulkan-driver=lib   load this Vulkan driver library (e.g. lavapipe)\n");
+        printf("  --require-gpu=0/1     fail instead of falling back to the CPU\n");
+        printf("  --gpu-preprocess=1    letterbox on the Vulkan device from the uint8 frame (0 = on the CPU)\n");
+        printf("  --fast-resize=1       box-filter frames that are an integer multiple of the input size (0 = bilinear)\n");
+        printf("  --stream-decode=0/1   decode large JPEGs scanline by scanline straight to input size (--serve, --watch,\n");
+        printf("                        directory and single image; results are then drawn at input size)\n");
+        printf("  --resize-compare=1    time and compare both resize paths on imagepath at common camera resolutions\n");
+        printf("  --shader-cache=dir    move the Vulkan driver's shader cache to dir\n");
+        printf("  --optimize=outmodel   fuse SiLU chains etc. into outmodel.param/.bin, verified on imagepath\n");
+        printf("  --pack=out.ncnnz      compressed model container (load it by passing out.ncnnz as modelpath)\n");
+        printf("  --pack-fp16=0/1       store fp32 convolution weights as fp16 in the container\n");
+        printf("  --pack-level=19       zstd level\n");
+        printf("  --prune=outmodel      keep only --classes in the detection head, verified on imagepath\n");
+        printf("  --classes=0,2         class subset for --prune, and the labels of a pruned model\n");
+        printf("  --bench=N             time N passes over imagepath (file or directory)\n");
+        printf("  --bench-out=file.json save results with an environment fingerprint\n");
+        printf("  --backend=ncnn        ncnn | ncnn-incremental | ncnn-fused-stem | ncnn-split | opencv (<modelpath>.onnx)\n");
+        printf("  --split=layer         ncnn-split: layers before this one on the GPU, the rest on the CPU\n");
+        printf("  --backends=ncnn       comma separated list of the above for --bench\n");
+        printf("  --serve=port          detector server (imagepath warms it up), see --loadgen\n");
+        printf("  --bind=127.0.0.1      server listen address\n");
+        printf("  --replay=speed        imagepath is a trace dir; 1 = original timing, 0 = max speed\n");
+        printf("  --queue=2             replay queue depth before frames are dropped\n");
+        printf("  --workers=cpu,gpu     replay with one detector per entry (cpu | gpu | split), frames go to the earliest finisher\n");
+        printf("  --watch=1             imagepath is a directory to watch; new images (and the backlog) go to the --workers pool\n");
+        printf("  --sink=file           watch mode: append JSON lines to file (- = stdout) instead of <image>.json next to each image\n");
+        printf("  --batch-ms=200        watch mode: a batch closes after this long without a new file\n");
+        printf("  --max-batch=32        watch mode: ... or at this many files\n");
+        printf("  --clips=dir           imagepath is a camera, stream, video or trace dir; save clips around detections\n");
+        printf("  --clip-labels=-1      comma separated labels that trigger a clip (-1 = all)\n");
+        printf("  --pre=5 --post=5      clip seconds before the first and after the last triggering frame\n");
+        printf("  --clip-mb=64          memory for the pre-roll ring of JPEG frames\n");
+        printf("  --deltas=file         imagepath is a camera, stream, video or trace dir; write appear/move/gone events (- = stdout)\n");
+        printf("  --delta-format=json   json | bin (16 byte records)\n");
+        printf("  --move-iou=0.7        report a move once the IoU with the last reported box drops below this\n");
+        printf("  --hold=3              frames an object may be missed before it is reported gone\n");
+        printf("  --keyframe=150        frames between full snapshots (0 = first frame only)\n");
+        printf("  --out-dir=results     directory mode: where the annotated <name>.jpg files go\n");
+        printf("  --prefetch=8          directory mode: files read ahead of the detector (io_uring or thread pool)\n");
+        printf("  --preview=0           draw and save at this longer side (0 = full size)\n");
+        printf("  --stage2=modelpath    classify/embed detected crops with a second model\n");
+        printf("  --stage2-size=224     stage-two input size\n");
+        printf("  --stage2-embed=0/1    store L2-normalized embeddings instead of class\n");
+        printf("  --stage2-labels=0     comma separated detector labels to crop (-1 = all)\n");
+        return -1;
+    }
+
+    std::string image_path = args[1];
+    std::string model_path = args[2];
+    bool use_int8 = false;
+    float conf_thres = 0.25f;
+    float nms_thres = 0.45f;
+    if(args.size()>3) use_int8 = std::stoi(args[3]);
+    if(args.size()>4) conf_thres = std::stof(args[4]);
+    if(args.size()>5) nms_thres = std::stof(args[5]);
+
+    // model rewrite: imagepath is the image set the result is verified on
+    std::string optimize_out = get_option(argc, argv, "optimize");
+    if (!optimize_out.empty())
+        return run_graph_optimizer(model_path, optimize_out, image_path, use_int8);
+
+    if (std::stoi(get_option(argc, argv, "resize-compare", "0")))
+        return run_resize_compare(image_path);
+
+    std::string pack_out = get_option(argc, argv, "pack");
+    if (!pack_out.empty())
+        return run_model_packer(model_path, pack_out, std::stoi(get_option(argc, argv, "pack-fp16", "0")),
+                                std::stoi(get_option(argc, argv, "pack-level", "19")), image_path, use_int8);
+
+    std::vector<std::string> class_names = {
+        "person", "bicycle", "car", "motorcycle", "airplane", "bus", "train", "truck", "boat", "traffic light",
+        "fire hydrant", "stop sign", "parking meter", "bench", "bird", "cat", "dog", "horse", "sheep", "cow",
+        "elephant", "bear", "zebra", "giraffe", "backpack", "umbrella", "handbag", "tie", "suitcase", "frisbee",
+        "skis", "snowboard", "sports ball", "kite", "baseball bat", "baseball glove", "skateboard", "surfboard",
+        "tennis racket", "bottle", "wine glass", "cup", "fork", "knife", "spoon", "bowl", "banana", "apple",
+        "sandwich", "orange", "broccoli", "carrot", "hot dog", "pizza", "donut", "cake", "chair", "couch",
+        "potted plant", "bed", "dining table", "toilet", "tv", "laptop", "mouse", "remote", "keyboard", "cell phone",
+        "microwave", "oven", "toaster", "sink", "refrigerator", "book", "clock", "vase", "scissors", "teddy bear",
+        "hair drier", "toothbrush"};
+
+    // --classes: the label subset of a model pruned with --prune (same list)
+    std::vector<int> classes;
+    std::stringstream classes_ss(get_option(argc, argv, "classes"));
+    for (std::string tok; std::getline(classes_ss, tok, ',');)
+        classes.push_back(std::stoi(tok));
+
+    std::string prune_out = get_option(argc, argv, "prune");
+    if (!prune_out.empty())
+        return run_class_pruner(model_path, prune_out, classes, image_path, use_int8);
+
+    if (!classes.empty())
+    {
+        std::vector<std::string> subset;
+        for (int c : classes)
+            subset.push_back(c >= 0 && c < (int)class_names.size() ? class_names[c] : std::to_string(c));
+        class_names = subset;
+    }
+
+    std::string task_name = get_option(argc, argv, "task", "detect");
+    int task = TASK_DETECT;
+    if (task_name == "segment")
+        task = TASK_SEGMENT;
+    else if (task_name == "pose")
+        task = TASK_POSE;
+    else if (task_name == "obb")
+        task = TASK_OBB;
+
+    // probe once up front so every backend uses the same device, and a node
+    // without a usable GPU reports it instead of quietly running on the CPU
+    std::string gpu = get_option(argc, argv, "gpu", "auto");
+    std::string shader_cache = get_option(argc, argv, "shader-cache");
+    if (!shader_cache.empty() && gpu != "off")
+        set_shader_cache_dir(shader_cache);
+    int gpu_device = gpu == "off" ? -1 : probe_vulkan_device(gpu, get_option(argc, argv, "vulkan-driver"));
+    if (gpu_device < 0 && gpu != "off" && std::stoi(get_option(argc, argv, "require-gpu", "0")))
+    {
+        fprintf(stderr, "Vulkan device required (--gpu=%s) but not available\n", gpu.c_str());
+        return -1;
+    }
+    bool use_vulkan = gpu_device >= 0;
+    bool gpu_preprocess = std::stoi(get_option(argc, argv, "gpu-preprocess", "1"));
+    bool fast_resize = std::stoi(get_option(argc, argv, "fast-resize", "1"));
+    bool stream_decode = std::stoi(get_option(argc, argv, "stream-decode", "0"));
+
+    std::string split_layer = get_option(argc, argv, "split");
+    auto make_backend = [&](const std::string &kind, bool vulkan) -> std::unique_ptr<InferenceBackend> {
+        if (kind == "ncnn-split")
+            return std::make_unique<SplitNcnnBackend>(model_path, split_layer, use_int8, gpu_device);
+        return create_backend(kind, model_path, vulkan, use_int8, gpu_device);
+    };
+
+    int bench_iters = std::stoi(get_option(argc, argv, "bench", "0"));
+    if (bench_iters > 0)
+    {
+        std::vector<cv::Mat> images = load_images(image_path);
+        if (images.empty())
+        {
+            fprintf(stderr, "No images found: %s\n", image_path.c_str());
+            return -1;
+        }
+
+        std::vector<BenchmarkResult> results;
+        std::stringstream ss(get_option(argc, argv, "backends", "ncnn"));
+        for (std::string kind; std::getline(ss, kind, ',');)
+        {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            std::unique_ptr<InferenceBackend> backend = make_backend(kind, use_vulkan);
+            if (!backend)
+            {
+                fprintf(stderr, "Unknown backend: %s\n", kind.c_str());
+                return -1;
+            }
+            YoloV11 yolo(std::move(backend), class_names, conf_thres, nms_thres, task);
+            yolo.gpu_preprocess = gpu_preprocess;
+            yolo.fast_resize = fast_resize;
+            yolo.verbose = false;
+            double load_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+            results.push_back(run_benchmark(yolo, images, bench_iters));
+            results.back().load_ms = load_ms;
+        }
+        print_comparison(results);
+
+        std::string bench_out = get_option(argc, argv, "bench-out");
+        if (!bench_out.empty())
+        {
+            if (!save_benchmark(bench_out, probe_environment(model_path), results))
+            {
+                fprintf(stderr, "Failed to write %s\n", bench_out.c_str());
+                return -1;
+            }
+            printf("[INFO] Saved benchmark results as %s\n", bench_out.c_str());
+        }
+        return 0;
+    }
+
+    std::string backend_kind = get_option(argc, argv, "backend", "ncnn");
+    std::unique_ptr<InferenceBackend> backend = make_backend(backend_kind, use_vulkan);
+    if (!backend)
+    {
+        fprintf(stderr, "Unknown backend: %s\n", backend_kind.c_str());
+        return -1;
+    }
+
+    // cpu = ncnn on the CPU, gpu = ncnn on the Vulkan device, split = --split
+    auto make_detectors = [&](const std::string &workers, std::vector<std::unique_ptr<YoloV11>> &detectors) {
+        std::stringstream ss(workers);
+        for (std::string kind; std::getline(ss, kind, ',');)
+        {
+            // a gpu worker on the CPU would make the split look heterogeneous
+            // when it is not
+            if ((kind == "gpu" || kind == "split") && !use_vulkan)
+            {
+                fprintf(stderr, "Worker %s needs a Vulkan device (--gpu=%s found none)\n", kind.c_str(), gpu.c_str());
+                return false;
+            }
+            std::unique_ptr<InferenceBackend> b;
+            if (kind == "cpu")
+                b = make_backend("ncnn", false);
+            else if (kind == "gpu")
+                b = make_backend("ncnn", true);
+            else if (kind == "split")
+                b = make_backend("ncnn-split", true);
+            if (!b)
+            {
+                fprintf(stderr, "Unknown worker: %s\n", kind.c_str());
+                return false;
+            }
+            detectors.push_back(std::make_unique<YoloV11>(std::move(b), class_names, conf_thres, nms_thres, task));
+            detectors.back()->gpu_preprocess = gpu_preprocess;
+            detectors.back()->fast_resize = fast_resize;
+        }
+        return true;
+    };
+
+    std::string serve_port = get_option(argc, argv, "serve");
+    if (!serve_port.empty())
+    {
+        YoloV11 yolo(std::move(backend), class_names, conf_thres, nms_thres, task);
+        yolo.gpu_preprocess = gpu_preprocess;
+        yolo.fast_resize = fast_resize;
+        yolo.verbose = false;
+        cv::Mat warmup = cv::imread(image_path);
+        std::vector<Object> objects;
+        if (!warmup.empty())
+            yolo.detect(warmup, objects);
+        return run_server(yolo, get_option(argc, argv, "bind", "127.0.0.1"), std::stoi(serve_port), stream_decode);
+    }
+
+    // a watched directory: new images go to the --workers pool (or the
+    // --backend detector alone) in batches, results are written per image
+    if (std::stoi(get_option(argc, argv, "watch", "0")))
+    {
+        std::vector<std::unique_ptr<YoloV11>> detectors;
+        std::string workers = get_option(argc, argv, "workers");
+        if (workers.empty())
+        {
+            detectors.push_back(std::make_unique<YoloV11>(std::move(backend), class_names, conf_thres, nms_thres, task));
+            detectors.back()->gpu_preprocess = gpu_preprocess;
+            detectors.back()->fast_resize = fast_resize;
+        }
+        else if (!make_detectors(workers, detectors))
+        {
+            return -1;
+        }
+        HeteroScheduler sched(std::move(detectors));
+        WatchOptions watch;
+        watch.sink = get_option(argc, argv, "sink");
+        watch.stream_decode = stream_decode;
+        watch.batch_ms = std::stoi(get_option(argc, argv, "batch-ms", "200"));
+        watch.max_batch = std::max(1, std::stoi(get_option(argc, argv, "max-batch", "32")));
+        return watch_directory(sched, class_names, image_path, watch);
+    }
+
+    // live source: clips of the frames around detections, nothing else is written
+    std::string clip_dir = get_option(argc, argv, "clips");
+    if (!clip_dir.empty())
+    {
+        YoloV11 yolo(std::move(backend), class_names, conf_thres, nms_thres, task);
+        yolo.gpu_preprocess = gpu_preprocess;
+        yolo.fast_resize = fast_resize;
+        yolo.verbose = false;
+        ClipOptions clips;
+        clips.out_dir = clip_dir;
+        std::stringstream ss(get_option(argc, argv, "clip-labels", "-1"));
+        for (std::string tok; std::getline(ss, tok, ',');)
+            if (std::stoi(tok) >= 0)
+                clips.labels.push_back(std::stoi(tok));
+        clips.pre_s = std::stod(get_option(argc, argv, "pre", "5"));
+        clips.post_s = std::stod(get_option(argc, argv, "post", "5"));
+        clips.max_bytes = (size_t)std::stoi(get_option(argc, argv, "clip-mb", "64")) << 20;
+        return run_event_clips(yolo, image_path, clips, std::stoi(get_option(argc, argv, "frames", "0")));
+    }
+
+    // live source: changes of the detections instead of every frame
+    std::string delta_out = get_option(argc, argv, "deltas");
+    if (!delta_out.empty())
+    {
+        YoloV11 yolo(std::move(backend), class_names, conf_thres, nms_thres, task);
+        yolo.gpu_preprocess = gpu_preprocess;
+        yolo.fast_resize = fast_resize;
+        yolo.verbose = false;
+        DeltaOptions deltas;
+        deltas.binary = get_option(argc, argv, "delta-format", "json") == "bin";
+        deltas.move_iou = std::stof(get_option(argc, argv, "move-iou", "0.7"));
+        deltas.hold_frames = std::stoi(get_option(argc, argv, "hold", "3"));
+        deltas.keyframe_interval = std::stoi(get_option(argc, argv, "keyframe", "150"));
+        return run_delta_stream(yolo, image_path, delta_out, deltas, std::stoi(get_option(argc, argv, "frames", "0")));
+    }
+
+    std::string replay_speed = get_option(argc, argv, "replay");
+    if (!replay_speed.empty())
+    {
+        Trace trace;
+        if (!load_trace(image_path, trace))
+        {
+            fprintf(stderr, "Failed to read trace: %s/trace.csv\n", image_path.c_str());
+            return -1;
+        }
+        const double speed = std::stod(replay_speed);
+        const int queue_depth = std::stoi(get_option(argc, argv, "queue", "2"));
+
+        std::string workers = get_option(argc, argv, "workers");
+        if (!workers.empty())
+        {
+            std::vector<std::unique_ptr<YoloV11>> detectors;
+            if (!make_detectors(workers, detectors))
+                return -1;
+            HeteroScheduler sched(std::move(detectors));
+            ReplayReport report = replay_trace(sched, trace, speed, queue_depth);
+            print_replay_report(report);
+            sched.print_stats();
+            return 0;
+        }
+
+        YoloV11 yolo(std::move(backend), class_names, conf_thres, nms_thres, task);
+        yolo.gpu_preprocess = gpu_preprocess;
+        yolo.fast_resize = fast_resize;
+        yolo.verbose = false;
+        ReplayReport report = replay_trace(yolo, trace, speed, queue_depth);
+        print_replay_report(report);
+        return 0;
+    }
+
+    // a directory: every image in it, with reads and result writes in flight
+    // while the detector runs
+    struct stat path_stat;
+    if (stat(image_path.c_str(), &path_stat) == 0 && S_ISDIR(path_stat.st_mode))
+    {
+        YoloV11 yolo(std::move(backend), class_names, conf_thres, nms_thres, task);
+        yolo.gpu_preprocess = gpu_preprocess;
+        yolo.fast_resize = fast_resize;
+        yolo.verbose = false;
+        IngestOptions ingest;
+        ingest.out_dir = get_option(argc, argv, "out-dir", ingest.out_dir);
+        ingest.stream_decode = stream_decode;
+        ingest.preview_size = std::stoi(get_option(argc, argv, "preview", "0"));
+        ingest.prefetch = std::stoi(get_option(argc, argv, "prefetch", "8"));
+        return process_directory(yolo, image_path, ingest);
+    }
+
+    // without stage two, a large JPEG is only ever needed at input size; the
+    // result is then drawn at that size too
+    std::string stage2_path = get_option(argc, argv, "stage2");
+    cv::Mat img;
+    cv::Size full_size;
+    if (stream_decode && stage2_path.empty() && read_jpeg_fit(image_path, TARGET_SIZE, img, full_size))
+        printf("[INFO] Decoded %dx%d JPEG at %dx%d\n", full_size.width, full_size.height, img.cols, img.rows);
+    else
+        img = cv::imread(image_path);
+    if (img.empty())
+    {
+        fprintf(stderr, "Failed to read image: %s\n", image_path.c_str());
+        return -1;
+    }
+
+
+    YoloV11 yolo(std::move(backend), class_names, conf_thres, nms_thres, task);
+    yolo.gpu_preprocess = gpu_preprocess;
+    yolo.fast_resize = fast_resize;
+    std::vector<Object> objects;
+    yolo.detect(img, objects);
+
+    if (!stage2_path.empty())
+    {
+        int size = std::stoi(get_option(argc, argv, "stage2-size", "224"));
+        bool embed = std::stoi(get_option(argc, argv, "stage2-embed", "0"));
+        std::vector<int> labels;
+        std::stringstream ss(get_option(argc, argv, "stage2-labels", "0"));
+        for (std::string tok; std::getline(ss, tok, ',');)
+            if (std::stoi(tok) >= 0)
+                labels.push_back(std::stoi(tok));
+        CropClassifier stage2(stage2_path, size, size, embed ? CropClassifier::EMBED : CropClassifier::CLASSIFY, labels);
+        stage2.classify(img, objects);
+    }
+
+    yolo.save_result(img, objects, std::stoi(get_option(argc, argv, "preview", "0")));
+    return 0;
+}
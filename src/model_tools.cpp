@@ -0,0 +1,649 @@
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <math.h>
+#include <sstream>
+#include <stdint.h>
+#include <string.h>
+#include "backend.h"
+#include "benchmark.h"
+#include "model_tools.h"
+#include "weight_pack.h"
+#include "yolo11.h"
+
+std::string ParamLayer::param(int key, const std::string &def) const
+{
+    const std::string prefix = std::to_string(key) + "=";
+    for (const auto &p : params)
+        if (p.compare(0, prefix.size(), prefix) == 0)
+            return p.substr(prefix.size());
+    return def;
+}
+
+void ParamLayer::set_param(int key, const std::string &value)
+{
+    const std::string prefix = std::to_string(key) + "=";
+    for (auto &p : params)
+    {
+        if (p.compare(0, prefix.size(), prefix) == 0)
+        {
+            p = prefix + value;
+            return;
+        }
+    }
+    params.push_back(prefix + value);
+}
+
+int ParamGraph::blob_count() const
+{
+    std::vector<std::string> blobs;
+    for (const auto &l : layers)
+        blobs.insert(blobs.end(), l.tops.begin(), l.tops.end());
+    std::sort(blobs.begin(), blobs.end());
+    return std::unique(blobs.begin(), blobs.end()) - blobs.begin();
+}
+
+int ParamGraph::producer(const std::string &blob) const
+{
+    for (size_t i = 0; i < layers.size(); i++)
+        if (std::find(layers[i].tops.begin(), layers[i].tops.end(), blob) != layers[i].tops.end())
+            return i;
+    return -1;
+}
+
+std::vector<int> ParamGraph::consumers(const std::string &blob) const
+{
+    std::vector<int> idx;
+    for (size_t i = 0; i < layers.size(); i++)
+        if (std::find(layers[i].bottoms.begin(), layers[i].bottoms.end(), blob) != layers[i].bottoms.end())
+            idx.push_back(i);
+    return idx;
+}
+
+bool load_param_graph(const std::string &path, ParamGraph &graph)
+{
+    std::ifstream f(path);
+    int magic = 0, layer_count = 0, blob_count = 0;
+    if (!(f >> magic >> layer_count >> blob_count) || magic != 7767517)
+        return false;
+
+    graph.layers.clear();
+    std::string line;
+    std::getline(f, line);
+    while ((int)graph.layers.size() < layer_count && std::getline(f, line))
+    {
+        std::istringstream ss(line);
+        ParamLayer l;
+        int nb = 0, nt = 0;
+        if (!(ss >> l.type >> l.name >> nb >> nt))
+            continue;
+        l.bottoms.resize(nb);
+        l.tops.resize(nt);
+        for (auto &b : l.bottoms)
+            ss >> b;
+        for (auto &t : l.tops)
+            ss >> t;
+        for (std::string p; ss >> p;)
+            l.params.push_back(p);
+        graph.layers.push_back(l);
+    }
+    return (int)graph.layers.size() == layer_count;
+}
+
+std::string format_param_graph(const ParamGraph &graph)
+{
+    std::string text = "7767517\n" + std::to_string(graph.layers.size()) + " " + std::to_string(graph.blob_count()) + "\n";
+    char head[128];
+    for (const auto &l : graph.layers)
+    {
+        snprintf(head, sizeof(head), "%-24s %-24s %d %d", l.type.c_str(), l.name.c_str(), (int)l.bottoms.size(), (int)l.tops.size());
+        text += head;
+        for (const auto &b : l.bottoms)
+            text += " " + b;
+        for (const auto &t : l.tops)
+            text += " " + t;
+        for (const auto &p : l.params)
+            text += " " + p;
+        text += "\n";
+    }
+    return text;
+}
+
+bool save_param_graph(const std::string &path, const ParamGraph &graph)
+{
+    FILE *fp = fopen(path.c_str(), "w");
+    if (!fp)
+        return false;
+    const std::string text = format_param_graph(graph);
+    bool ok = fwrite(text.data(), 1, text.size(), fp) == text.size();
+    return (fclose(fp) == 0) && ok;
+}
+
+// x * sigmoid(x) as exported when the activation is not recognized:
+//   Split    s  1 n  x ... a b ...
+//   Sigmoid  g  1 1  b c
+//   BinaryOp m  2 1  a c y  0=2
+// becomes Swish x -> y; the Split keeps its other outputs, if any.
+static bool fuse_swish(ParamGraph &g)
+{
+    for (size_t i = 0; i < g.layers.size(); i++)
+    {
+        const ParamLayer &mul = g.layers[i];
+        if (mul.type != "BinaryOp" || mul.bottoms.size() != 2 || mul.param(0, "0") != "2" || mul.param(1, "0") != "0")
+            continue;
+
+        for (int s = 0; s < 2; s++)
+        {
+            const std::string sig_out = mul.bottoms[s], a = mul.bottoms[1 - s];
+            int gi = g.producer(sig_out);
+            if (gi < 0 || g.layers[gi].type != "Sigmoid" || g.consumers(sig_out).size() != 1)
+                continue;
+            const std::string b = g.layers[gi].bottoms[0];
+            int si = g.producer(b);
+            if (si < 0 || g.layers[si].type != "Split" || g.producer(a) != si || a == b)
+                continue;
+            if (g.consumers(a).size() != 1 || g.consumers(b).size() != 1)
+                continue;
+
+            ParamLayer &split = g.layers[si];
+            std::vector<std::string> rest;
+            for (const auto &t : split.tops)
+                if (t != a && t != b)
+                    rest.push_back(t);
+
+            ParamLayer swish;
+            swish.type = "Swish";
+            swish.name = mul.name;
+            swish.tops = mul.tops;
+            if (rest.empty())
+            {
+                swish.bottoms.push_back(split.bottoms[0]);
+            }
+            else
+            {
+                rest.push_back(b);
+                split.tops = rest;
+                swish.bottoms.push_back(b);
+            }
+            g.layers[i] = swish;
+
+            // erase the later layer first so the other index stays valid
+            if (rest.empty())
+            {
+                g.layers.erase(g.layers.begin() + std::max(gi, si));
+                g.layers.erase(g.layers.begin() + std::min(gi, si));
+            }
+            else
+            {
+                g.layers.erase(g.layers.begin() + gi);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+GraphOptStats optimize_graph(ParamGraph &graph)
+{
+    GraphOptStats stats;
+    while (fuse_swish(graph))
+        stats.swish++;
+    return stats;
+}
+
+bool verify_models(const std::string &model_a, const std::string &model_b, const std::string &verify_dir, int num_outputs, float tol, float rel_tol, bool int8,
+                   const std::vector<int> &out0_rows)
+{
+    std::vector<cv::Mat> images = load_images(verify_dir);
+    if (images.empty())
+    {
+        fprintf(stderr, "No images found: %s\n", verify_dir.c_str());
+        return false;
+    }
+
+    // both on the CPU in fp32, so only the graph change shows up and not
+    // the bf16/fp16 rounding of intermediate blobs it moves around
+    NcnnBackend a(model_a, false, int8, -1, true), b(model_b, false, int8, -1, true);
+    std::vector<float> max_diff(num_outputs, 0.f);
+    std::vector<long long> outside(num_outputs, 0);
+    auto compare = [&](int o, const float *pa, const float *pb, int n) {
+        for (int k = 0; k < n; k++)
+        {
+            const float d = fabsf(pa[k] - pb[k]);
+            max_diff[o] = std::max(max_diff[o], d);
+            outside[o] += d > tol + rel_tol * fabsf(pa[k]);
+        }
+    };
+    for (const auto &img : images)
+    {
+        float scale;
+        ncnn::Mat in = letterbox_input(img, make_letterbox(img.cols, img.rows, scale));
+
+        std::vector<ncnn::Mat> oa, ob;
+        if (a.infer(in, oa, num_outputs) != 0 || b.infer(in, ob, num_outputs) != 0)
+        {
+            fprintf(stderr, "[VERIFY] inference failed\n");
+            return false;
+        }
+        if (!out0_rows.empty())
+        {
+            if (oa[0].w != ob[0].w || ob[0].h != (int)out0_rows.size())
+            {
+                fprintf(stderr, "[VERIFY] out0 shape differs: %dx%d vs %dx%d\n", oa[0].w, oa[0].h, ob[0].w, ob[0].h);
+                return false;
+            }
+            for (size_t r = 0; r < out0_rows.size(); r++)
+            {
+                compare(0, oa[0].row(out0_rows[r]), ob[0].row(r), oa[0].w);
+            }
+        }
+        for (int o = out0_rows.empty() ? 0 : 1; o < num_outputs; o++)
+        {
+            if (oa[o].w != ob[o].w || oa[o].h != ob[o].h || oa[o].c != ob[o].c)
+            {
+                fprintf(stderr, "[VERIFY] out%d shape differs: %dx%dx%d vs %dx%dx%d\n", o, oa[o].w, oa[o].h, oa[o].c, ob[o].w, ob[o].h, ob[o].c);
+                return false;
+            }
+            for (int q = 0; q < oa[o].c; q++)
+                compare(o, oa[o].channel(q), ob[o].channel(q), oa[o].w * oa[o].h);
+        }
+    }
+
+    bool ok = true;
+    for (int o = 0; o < num_outputs; o++)
+    {
+        printf("[VERIFY] out%d: max abs diff %.3g over %zu images, %lld values outside %.3g + %.3g * |ref|\n", o, max_diff[o], images.size(),
+               outside[o], tol, rel_tol);
+        ok &= outside[o] == 0;
+    }
+    return ok;
+}
+
+static bool copy_file(const std::string &from, const std::string &to)
+{
+    std::ifstream src(from, std::ios::binary);
+    std::ofstream dst(to, std::ios::binary);
+    if (!src || !dst)
+        return false;
+    dst << src.rdbuf();
+    return (bool)dst;
+}
+
+int run_graph_optimizer(const std::string &in_model, const std::string &out_model, const std::string &verify_dir, bool int8)
+{
+    ParamGraph graph;
+    if (!load_param_graph(in_model + ".param", graph))
+    {
+        fprintf(stderr, "Failed to read %s.param\n", in_model.c_str());
+        return -1;
+    }
+    const int layers_before = graph.layers.size(), blobs_before = graph.blob_count();
+
+    GraphOptStats stats = optimize_graph(graph);
+    printf("[OPTIMIZE] fused %d Swish\n", stats.swish);
+    printf("[OPTIMIZE] layers %d -> %d, blobs %d -> %d\n", layers_before, (int)graph.layers.size(), blobs_before, graph.blob_count());
+
+    if (!save_param_graph(out_model + ".param", graph) || !copy_file(in_model + ".bin", out_model + ".bin"))
+    {
+        fprintf(stderr, "Failed to write %s.param/.bin\n", out_model.c_str());
+        return -1;
+    }
+    printf("[OPTIMIZE] wrote %s.param/.bin\n", out_model.c_str());
+
+    if (verify_dir.empty())
+        return 0;
+    const int num_outputs = graph.producer("out1") >= 0 ? 2 : 1;
+    // Swish and x * sigmoid(x) differ in the last fp32 bits
+    return verify_models(in_model, out_model, verify_dir, num_outputs, 1e-4f, 1e-5f, int8) ? 0 : 1;
+}
+
+// Weight blobs are read in layer order by ModelBin::load(). Type 0 blobs
+// start with a 4-byte tag selecting the storage, type 1 blobs are raw fp32.
+struct WeightBlob
+{
+    size_t offset = 0; // of the tag for tagged blobs
+    size_t size = 0;   // total bytes including tag and table
+    int count = 0;     // elements
+    bool tagged = false;
+};
+
+static const uint32_t TAG_FP16 = 0x01306B47;
+static const uint32_t TAG_INT8 = 0x000D4B38;
+static const uint32_t TAG_FP32_EXTRA = 0x0002C056;
+
+static size_t align4(size_t n)
+{
+    return (n + 3) / 4 * 4;
+}
+
+// element bytes and header bytes (tag, plus the 256-entry table of
+// quantized weights) of a tagged blob
+static void tagged_layout(const unsigned char *p, int &elem_size, size_t &header)
+{
+    uint32_t tag;
+    memcpy(&tag, p, 4);
+    header = 4;
+    if (tag == TAG_FP16)
+        elem_size = 2;
+    else if (tag == TAG_INT8)
+        elem_size = 1;
+    else if (tag == TAG_FP32_EXTRA || (p[0] | p[1] | p[2] | p[3]) == 0)
+        elem_size = 4;
+    else
+    {
+        elem_size = 1;
+        header += 256 * sizeof(float);
+    }
+}
+
+static bool add_blob(const std::vector<unsigned char> &bin, size_t &offset, int count, bool tagged, std::vector<WeightBlob> &blobs)
+{
+    WeightBlob b;
+    b.offset = offset;
+    b.count = count;
+    b.tagged = tagged;
+    if (tagged)
+    {
+        if (offset + 4 > bin.size())
+            return false;
+        int elem_size;
+        size_t header;
+        tagged_layout(&bin[offset], elem_size, header);
+        b.size = header + align4((size_t)count * elem_size);
+    }
+    else
+    {
+        b.size = (size_t)count * sizeof(float);
+    }
+    offset += b.size;
+    blobs.push_back(b);
+    return offset <= bin.size();
+}
+
+static int iparam(const ParamLayer &l, int key, int def)
+{
+    return std::stoi(l.param(key, std::to_string(def)));
+}
+
+// Per-layer weight blobs of the .bin. Fails on layer types whose weight
+// layout is not known here, rather than silently misplacing everything after.
+static bool map_weights(const ParamGraph &g, const std::vector<unsigned char> &bin, std::vector<std::vector<WeightBlob>> &weights)
+{
+    static const char *weightless[] = {"Input", "Swish", "Split", "Concat", "Slice", "Sigmoid", "BinaryOp", "Reshape", "Permute", "Softmax",
+                                       "Pooling", "Interp", "MatMul", "ReLU", "HardSwish", "Noop", "Crop", "Flatten", "Eltwise", "UnaryOp"};
+    size_t offset = 0;
+    weights.assign(g.layers.size(), std::vector<WeightBlob>());
+    for (size_t i = 0; i < g.layers.size(); i++)
+    {
+        const ParamLayer &l = g.layers[i];
+        std::vector<WeightBlob> &w = weights[i];
+        bool ok = true;
+        if (l.type == "Convolution" || l.type == "ConvolutionDepthWise")
+        {
+            const bool dw = l.type == "ConvolutionDepthWise";
+            const int num_output = iparam(l, 0, 0), group = iparam(l, 7, 1), int8_scale_term = iparam(l, 8, 0);
+            ok &= add_blob(bin, offset, iparam(l, 6, 0), true, w);
+            if (iparam(l, 5, 0))
+                ok &= add_blob(bin, offset, num_output, false, w);
+            if (int8_scale_term)
+            {
+                int weight_scales = num_output;
+                if (dw)
+                    weight_scales = int8_scale_term == 2 || int8_scale_term == 102 ? 1 : group;
+                ok &= add_blob(bin, offset, weight_scales, false, w);
+                ok &= add_blob(bin, offset, 1, false, w);
+            }
+            if (int8_scale_term > 100)
+                ok &= add_blob(bin, offset, 1, false, w);
+        }
+        else if (l.type == "MemoryData")
+        {
+            int count = std::max(iparam(l, 0, 0), 1) * std::max(iparam(l, 1, 0), 1) * std::max(iparam(l, 11, 0), 1) * std::max(iparam(l, 2, 0), 1);
+            ok &= add_blob(bin, offset, count, false, w);
+        }
+        else if (std::find_if(std::begin(weightless), std::end(weightless), [&](const char *t) { return l.type == t; }) == std::end(weightless))
+        {
+            fprintf(stderr, "Unsupported layer type with possible weights: %s %s\n", l.type.c_str(), l.name.c_str());
+            return false;
+        }
+        if (!ok)
+        {
+            fprintf(stderr, "%s %s runs past the end of the .bin\n", l.type.c_str(), l.name.c_str());
+            return false;
+        }
+    }
+    if (offset != bin.size())
+    {
+        fprintf(stderr, "Weights end at %zu, .bin has %zu bytes\n", offset, bin.size());
+        return false;
+    }
+    return true;
+}
+
+// Copies the rows (output channels) listed in keep of a blob holding
+// count / rows elements per row.
+static void slice_blob(const std::vector<unsigned char> &bin, const WeightBlob &b, int rows, const std::vector<int> &keep,
+                       std::vector<unsigned char> &out)
+{
+    int elem_size = 4;
+    size_t header = 0;
+    if (b.tagged)
+        tagged_layout(&bin[b.offset], elem_size, header);
+    const size_t row_bytes = (size_t)(b.count / rows) * elem_size;
+    const size_t start = out.size();
+    out.insert(out.end(), bin.begin() + b.offset, bin.begin() + b.offset + header);
+    for (int r : keep)
+        out.insert(out.end(), bin.begin() + b.offset + header + r * row_bytes, bin.begin() + b.offset + header + (r + 1) * row_bytes);
+    out.resize(start + header + (b.tagged ? align4(keep.size() * row_bytes) : keep.size() * row_bytes), 0);
+}
+
+// One detection-head scale: Concat(box, cls) -> Reshape(1=reg+nc)
+struct HeadBranch
+{
+    int cls_conv, reshape;
+};
+
+// The class logits leave the head as "Slice -23300=2,reg,nc" after the
+// per-scale Reshapes are concatenated; each Reshape is fed by a
+// Concat(box, cls) whose cls input comes from a Convolution with nc outputs.
+static bool find_head(const ParamGraph &g, int &slice, int &reg, int &nc, std::vector<HeadBranch> &branches)
+{
+    for (size_t i = 0; i < g.layers.size(); i++)
+    {
+        const ParamLayer &l = g.layers[i];
+        std::string sizes = l.param(-23300);
+        if (l.type != "Slice" || sizes.compare(0, 2, "2,") != 0)
+            continue;
+        if (sscanf(sizes.c_str(), "2,%d,%d", &reg, &nc) != 2 || nc <= 0)
+            continue;
+        int cat = g.producer(l.bottoms[0]);
+        if (cat < 0 || g.layers[cat].type != "Concat")
+            continue;
+
+        branches.clear();
+        for (const auto &b : g.layers[cat].bottoms)
+        {
+            int rs = g.producer(b);
+            if (rs < 0 || g.layers[rs].type != "Reshape" || iparam(g.layers[rs], 1, 0) != reg + nc)
+                break;
+            int pair = g.producer(g.layers[rs].bottoms[0]);
+            if (pair < 0 || g.layers[pair].type != "Concat" || g.layers[pair].bottoms.size() != 2)
+                break;
+            int conv = g.producer(g.layers[pair].bottoms[1]);
+            if (conv < 0 || g.layers[conv].type != "Convolution" || iparam(g.layers[conv], 0, 0) != nc)
+                break;
+            branches.push_back(HeadBranch{conv, rs});
+        }
+        if (!branches.empty() && branches.size() == g.layers[cat].bottoms.size())
+        {
+            slice = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool read_file(const std::string &path, std::vector<unsigned char> &data)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+        return false;
+    data.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+int run_class_pruner(const std::string &in_model, const std::string &out_model, const std::vector<int> &keep, const std::string &verify_dir,
+                     bool int8)
+{
+    ParamGraph graph;
+    std::vector<unsigned char> bin;
+    if (!load_param_graph(in_model + ".param", graph) || !read_file(in_model + ".bin", bin))
+    {
+        fprintf(stderr, "Failed to read %s.param/.bin\n", in_model.c_str());
+        return -1;
+    }
+
+    int slice = -1, reg = 0, nc = 0;
+    std::vector<HeadBranch> branches;
+    if (!find_head(graph, slice, reg, nc, branches))
+    {
+        fprintf(stderr, "No detection head (Concat -> Slice 2,reg,nc) found in %s.param\n", in_model.c_str());
+        return -1;
+    }
+    for (size_t k = 0; k < keep.size(); k++)
+    {
+        if (keep[k] < 0 || keep[k] >= nc || (k > 0 && keep[k] <= keep[k - 1]))
+        {
+            fprintf(stderr, "--classes must be ascending indices below %d\n", nc);
+            return -1;
+        }
+    }
+    if (keep.empty())
+    {
+        fprintf(stderr, "--classes is empty\n");
+        return -1;
+    }
+
+    std::vector<std::vector<WeightBlob>> weights;
+    if (!map_weights(graph, bin, weights))
+        return -1;
+
+    // rewrite the .bin layer by layer, slicing the cls convolutions
+    std::vector<unsigned char> out_bin;
+    out_bin.reserve(bin.size());
+    const int new_nc = keep.size();
+    for (size_t i = 0; i < graph.layers.size(); i++)
+    {
+        bool is_cls = std::find_if(branches.begin(), branches.end(), [&](const HeadBranch &b) { return b.cls_conv == (int)i; }) != branches.end();
+        for (const auto &b : weights[i])
+        {
+            // weights, bias and int8 weight scales are per output channel,
+            // the single bottom/top scales are not
+            if (is_cls && b.count % nc == 0 && b.count >= nc)
+                slice_blob(bin, b, nc, keep, out_bin);
+            else
+                out_bin.insert(out_bin.end(), bin.begin() + b.offset, bin.begin() + b.offset + b.size);
+        }
+        if (is_cls)
+        {
+            ParamLayer &conv = graph.layers[i];
+            conv.set_param(0, std::to_string(new_nc));
+            conv.set_param(6, std::to_string(iparam(conv, 6, 0) / nc * new_nc));
+        }
+    }
+    for (const auto &b : branches)
+        graph.layers[b.reshape].set_param(1, std::to_string(reg + new_nc));
+    graph.layers[slice].set_param(-23300, "2," + std::to_string(reg) + "," + std::to_string(new_nc));
+
+    FILE *fp = fopen((out_model + ".bin").c_str(), "wb");
+    bool written = fp && fwrite(out_bin.data(), 1, out_bin.size(), fp) == out_bin.size();
+    if (fp)
+        written &= fclose(fp) == 0;
+    if (!written || !save_param_graph(out_model + ".param", graph))
+    {
+        fprintf(stderr, "Failed to write %s.param/.bin\n", out_model.c_str());
+        return -1;
+    }
+    printf("[PRUNE] %zu head branches, classes %d -> %d, weights %zu -> %zu bytes, wrote %s.param/.bin\n", branches.size(), nc, new_nc, bin.size(),
+           out_bin.size(), out_model.c_str());
+
+    if (verify_dir.empty())
+        return 0;
+    // out0 rows: 4 box rows, then one per class, then any task extras
+    std::vector<int> rows = {0, 1, 2, 3};
+    for (int k : keep)
+        rows.push_back(4 + k);
+    const int num_outputs = graph.producer("out1") >= 0 ? 2 : 1;
+    // fp32 nets; fewer head channels can change the packing and with it the
+    // summation order
+    return verify_models(in_model, out_model, verify_dir, num_outputs, 1e-4f, 1e-5f, int8, rows) ? 0 : 1;
+}
+
+int run_model_packer(const std::string &in_model, const std::string &out_path, bool fp16, int level, const std::string &verify_dir, bool int8)
+{
+    ParamGraph graph;
+    std::vector<unsigned char> bin;
+    std::ifstream pf(in_model + ".param");
+    std::string param((std::istreambuf_iterator<char>(pf)), std::istreambuf_iterator<char>());
+    if (param.empty() || !load_param_graph(in_model + ".param", graph) || !read_file(in_model + ".bin", bin))
+    {
+        fprintf(stderr, "Failed to read %s.param/.bin\n", in_model.c_str());
+        return -1;
+    }
+
+    if (fp16)
+    {
+        std::vector<std::vector<WeightBlob>> weights;
+        if (!map_weights(graph, bin, weights))
+            return -1;
+
+        // fp32 convolution weights are stored as tagged fp16, which
+        // ModelBin expands on load; everything else is copied
+        std::vector<unsigned char> out;
+        out.reserve(bin.size());
+        int converted = 0;
+        for (const auto &layer : weights)
+        {
+            for (const auto &b : layer)
+            {
+                const unsigned char *p = &bin[b.offset];
+                if (!b.tagged || (p[0] | p[1] | p[2] | p[3]) != 0)
+                {
+                    out.insert(out.end(), p, p + b.size);
+                    continue;
+                }
+                const uint32_t tag = TAG_FP16;
+                const size_t start = out.size();
+                out.resize(start + 4 + align4((size_t)b.count * 2), 0);
+                memcpy(&out[start], &tag, 4);
+                for (int k = 0; k < b.count; k++)
+                {
+                    float v;
+                    memcpy(&v, p + 4 + (size_t)k * 4, 4);
+                    unsigned short h = ncnn::float32_to_float16(v);
+                    memcpy(&out[start + 4 + (size_t)k * 2], &h, 2);
+                }
+                converted++;
+            }
+        }
+        printf("[PACK] %d weight blobs converted to fp16, %zu -> %zu bytes\n", converted, bin.size(), out.size());
+        bin.swap(out);
+    }
+
+    if (!save_packed_model(out_path, param, bin, level))
+    {
+        fprintf(stderr, "Failed to write %s\n", out_path.c_str());
+        return -1;
+    }
+    std::ifstream packed(out_path, std::ios::binary | std::ios::ate);
+    printf("[PACK] wrote %s: %zu -> %lld bytes\n", out_path.c_str(), bin.size(), (long long)packed.tellg());
+
+    if (verify_dir.empty())
+        return 0;
+    // fp16 weights keep about 3 significant digits, the outputs move by
+    // about that much relative to their magnitude
+    const int num_outputs = graph.producer("out1") >= 0 ? 2 : 1;
+    const float tol = fp16 ? 1e-2f : 1e-4f, rel_tol = fp16 ? 1e-2f : 0.f;
+    bool ok = verify_models(in_model, out_path, verify_dir, num_outputs, tol, rel_tol, int8);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Text form of an ncnn .param file, one entry per layer line. Parameters
+// are kept as their "key=value" tokens so untouched layers round-trip
+// unchanged.
+struct ParamLayer
+{
+    std::string type, name;
+    std::vector<std::string> bottoms, tops;
+    std::vector<std::string> params;
+
+    // value of "key=..." or def; array values come back unparsed
+    std::string param(int key, const std::string &def = "") const;
+    void set_param(int key, const std::string &value);
+};
+
+struct ParamGraph
+{
+    std::vector<ParamLayer> layers;
+
+    int blob_count() const;
+    // layer index producing blob (-1 if none) and the indices consuming it
+    int producer(const std::string &blob) const;
+    std::vector<int> consumers(const std::string &blob) const;
+};
+
+bool load_param_graph(const std::string &path, ParamGraph &graph);
+bool save_param_graph(const std::string &path, const ParamGraph &graph);
+// .param text of graph, for Net::load_param_mem()
+std::string format_param_graph(const ParamGraph &graph);
+
+struct GraphOptStats
+{
+    int swish = 0; // Split -> Sigmoid -> BinaryOp(mul) chains fused into Swish
+};
+
+// Rewrites the graph in place. Only weightless layers are removed, so the
+// .bin file stays valid as is. The DFL head's Reshape -> Permute pair
+// (reshape_175 -> permute_168) is left alone: no stock ncnn layer does
+// both, and a custom one would run on the CPU between Vulkan layers and
+// make the model unloadable by other ncnn and OpenCV builds.
+GraphOptStats optimize_graph(ParamGraph &graph);
+
+// Runs both models on the CPU in fp32 (no bf16/fp16 storage or arithmetic)
+// over every image in verify_dir, letterboxed as detect() does, and prints
+// the largest absolute difference per output.
+// Returns false if any value of model_b differs from model_a's by more than
+// tol + rel_tol * |model_a's|.
+// With out0_rows, row r of model_b's out0 is compared to row out0_rows[r]
+// of model_a's.
+bool verify_models(const std::string &model_a, const std::string &model_b, const std::string &verify_dir, int num_outputs, float tol, float rel_tol, bool int8 = false,
+                   const std::vector<int> &out0_rows = std::vector<int>());
+
+// <in_model>.param/.bin -> <out_model>.param/.bin, verified on verify_dir
+// when it is not empty
+int run_graph_optimizer(const std::string &in_model, const std::string &out_model, const std::string &verify_dir, bool int8 = false);
+
+// Keeps only the classes in keep (ascending indices into the model's
+// labels): the per-scale classification convolutions lose the other output
+// channels and the Reshape/Slice shapes after them shrink to match. out0
+// then has 4 + keep.size() rows, which detect() decodes with the matching
+// reduced label list. Verified against the original rows when verify_dir
+// is given.
+int run_class_pruner(const std::string &in_model, const std::string &out_model, const std::vector<int> &keep, const std::string &verify_dir,
+                     bool int8 = false);
+
+// Packs <in_model>.param/.bin into a .ncnnz container (see weight_pack.h),
+// optionally storing fp32 convolution weights as fp16 first. The container
+// is loaded by passing its path (with extension) as the model path.
+int run_model_packer(const std::string &in_model, const std::string &out_path, bool fp16, int level, const std::string &verify_dir,
+                     bool int8 = false);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+struct Object
+{
+    cv::Rect_<float> rect;
+    int label;
+    float prob;
+    int anchor = -1; // column of the head output this object was decoded from
+
+    // segmentation: mask logits at prototype resolution covering mask_rect
+    // (image coordinates), see object_mask() for the full-resolution mask
+    cv::Mat mask;
+    cv::Rect_<float> mask_rect;
+
+    // pose: x, y, visibility per keypoint in image coordinates
+    std::vector<float> keypoints;
+
+    // oriented boxes: rect is the axis-aligned bound of obb (angle in degrees)
+    cv::RotatedRect obb;
+
+    // filled by CropClassifier (stage two), untouched otherwise
+    int sub_label = -1;
+    float sub_prob = 0.f;
+    std::vector<float> embedding;
+};
+
+// Binary CV_8U mask of obj.rect at image resolution. The prototype-resolution
+// logits are only upsampled here, so callers that never ask pay nothing.
+inline cv::Mat object_mask(const Object &obj)
+{
+    cv::Rect box = obj.rect;
+    if (obj.mask.empty() || box.width <= 0 || box.height <= 0)
+        return cv::Mat();
+
+    cv::Rect area = obj.mask_rect;
+    if (area.width <= 0 || area.height <= 0)
+        return cv::Mat();
+
+    cv::Mat logits;
+    cv::resize(obj.mask, logits, area.size(), 0, 0, cv::INTER_LINEAR);
+
+    // logit > 0 <=> sigmoid > 0.5
+    cv::Mat full = logits > 0.f;
+    cv::Mat out = cv::Mat::zeros(box.height, box.width, CV_8UC1);
+    cv::Rect inter = area & box;
+    if (inter.area() > 0)
+        full(inter - area.tl()).copyTo(out(inter - box.tl()));
+    return out;
+}
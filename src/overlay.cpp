@@ -0,0 +1,173 @@
+#include <algorithm>
+#include "overlay.h"
+
+static const int FONT = cv::FONT_HERSHEY_SIMPLEX;
+static const char NUMBER_CHARS[] = "0123456789.%# ";
+
+OverlayRenderer::OverlayRenderer(const std::vector<std::string> &class_names, double font_scale, int thickness)
+{
+    int baseline = 0;
+    cv::Size sz = cv::getTextSize("Ag", FONT, font_scale, thickness, &baseline);
+    ascent = sz.height;
+    line_height = sz.height + baseline + thickness;
+
+    // every glyph gets its own strip of the atlas, stacked vertically
+    std::vector<std::string> texts;
+    for (const auto &name : class_names)
+        texts.push_back(name + " ");
+    for (const char *c = NUMBER_CHARS; *c; c++)
+        texts.push_back(std::string(1, *c));
+
+    int atlas_w = 1;
+    for (const auto &t : texts)
+        atlas_w = std::max(atlas_w, cv::getTextSize(t, FONT, font_scale, thickness, &baseline).width);
+    atlas = cv::Mat::zeros(line_height * texts.size(), atlas_w, CV_8UC1);
+
+    int row = 0;
+    for (const auto &t : texts)
+    {
+        // Hershey advances glyph by glyph, so per-character tiles laid side
+        // by side reproduce what putText would draw for the whole string
+        int w = cv::getTextSize(t, FONT, font_scale, thickness, &baseline).width;
+        cv::putText(atlas, t, cv::Point(0, row * line_height + ascent), FONT, font_scale, cv::Scalar(255), thickness, cv::LINE_8);
+        Glyph g;
+        g.area = cv::Rect(0, row * line_height, w, line_height);
+        if (t.size() == 1 && row >= (int)class_names.size())
+            char_glyphs[(unsigned char)t[0]] = g;
+        else
+            label_glyphs.push_back(g);
+        row++;
+    }
+}
+
+void OverlayRenderer::blit(cv::Mat &image, const Glyph &g, int x, int y) const
+{
+    // text is black: dst = dst * (255 - a) / 255
+    const int x0 = std::max(0, x), x1 = std::min(image.cols, x + g.area.width);
+    const int y0 = std::max(0, y), y1 = std::min(image.rows, y + g.area.height);
+    for (int yy = y0; yy < y1; yy++)
+    {
+        const uchar *a = atlas.ptr<uchar>(g.area.y + yy - y) + (x0 - x);
+        uchar *p = image.ptr<uchar>(yy) + x0 * 3;
+        for (int xx = 0; xx < x1 - x0; xx++)
+        {
+            const int inv = 255 - a[xx];
+            p[xx * 3] = p[xx * 3] * inv / 255;
+            p[xx * 3 + 1] = p[xx * 3 + 1] * inv / 255;
+            p[xx * 3 + 2] = p[xx * 3 + 2] * inv / 255;
+        }
+    }
+}
+
+// "<int>.<frac>%" from a value in tenths of a percent, without sprintf
+int OverlayRenderer::blit_number(cv::Mat &image, int tenths, int x, int y) const
+{
+    char buf[16];
+    int n = 0;
+    buf[n++] = '%';
+    buf[n++] = '0' + tenths % 10;
+    buf[n++] = '.';
+    int v = tenths / 10;
+    do
+    {
+        buf[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v > 0);
+
+    while (n > 0)
+    {
+        const Glyph &g = char_glyphs[(unsigned char)buf[--n]];
+        blit(image, g, x, y);
+        x += g.area.width;
+    }
+    return x;
+}
+
+void fill_box(cv::Mat &image, const cv::Rect &box, const cv::Vec3b &color, int thickness)
+{
+    const cv::Rect bounds(0, 0, image.cols, image.rows);
+    const int t0 = thickness / 2, t1 = thickness - t0;
+    // top, bottom, left, right bands, each clipped and filled row by row
+    const cv::Rect bands[4] = {
+        cv::Rect(box.x - t0, box.y - t0, box.width + thickness, thickness) & bounds,
+        cv::Rect(box.x - t0, box.y + box.height - t0, box.width + thickness, thickness) & bounds,
+        cv::Rect(box.x - t0, box.y + t1, thickness, std::max(0, box.height - thickness)) & bounds,
+        cv::Rect(box.x + box.width - t0, box.y + t1, thickness, std::max(0, box.height - thickness)) & bounds};
+    for (const cv::Rect &b : bands)
+    {
+        for (int y = b.y; y < b.y + b.height; y++)
+        {
+            cv::Vec3b *p = image.ptr<cv::Vec3b>(y) + b.x;
+            std::fill(p, p + b.width, color);
+        }
+    }
+}
+
+void OverlayRenderer::draw(cv::Mat &image, const std::vector<Object> &objects, float scale) const
+{
+    const cv::Rect bounds(0, 0, image.cols, image.rows);
+    for (const auto &obj : objects)
+    {
+        cv::Rect box(cvRound(obj.rect.x * scale), cvRound(obj.rect.y * scale), cvRound(obj.rect.width * scale), cvRound(obj.rect.height * scale));
+
+        cv::Mat mask = object_mask(obj);
+        cv::Rect clipped = box & bounds;
+        if (!mask.empty() && clipped.area() > 0)
+        {
+            if (scale != 1.f)
+                cv::resize(mask, mask, box.size(), 0, 0, cv::INTER_NEAREST);
+            cv::Mat roi = image(clipped);
+            cv::Mat tint = roi * 0.5 + cv::Scalar(0, 127, 0);
+            tint.copyTo(roi, mask(clipped - box.tl()));
+        }
+        for (size_t k = 0; k + 2 < obj.keypoints.size(); k += 3)
+        {
+            if (obj.keypoints[k + 2] > 0.5f)
+                cv::circle(image, cv::Point(obj.keypoints[k] * scale, obj.keypoints[k + 1] * scale), 3, cv::Scalar(0, 0, 255), -1);
+        }
+        if (obj.obb.size.width > 0.f)
+        {
+            cv::Point2f pts[4];
+            obj.obb.points(pts);
+            for (int k = 0; k < 4; k++)
+                cv::line(image, pts[k] * scale, pts[(k + 1) % 4] * scale, cv::Scalar(255, 0, 0), 2);
+        }
+
+        fill_box(image, box, cv::Vec3b(0, 255, 0), 2);
+
+        // baseline 5px above the box, as with cv::putText before
+        int x = box.x;
+        const int y = box.y - 5 - ascent;
+        if (obj.label >= 0 && obj.label < (int)label_glyphs.size())
+        {
+            blit(image, label_glyphs[obj.label], x, y);
+            x += label_glyphs[obj.label].area.width;
+        }
+        x = blit_number(image, cvRound(obj.prob * 1000), x, y);
+        if (obj.sub_label >= 0)
+        {
+            const Glyph &sp = char_glyphs[(unsigned char)' '];
+            const Glyph &hash = char_glyphs[(unsigned char)'#'];
+            blit(image, sp, x, y);
+            x += sp.area.width;
+            blit(image, hash, x, y);
+            x += hash.area.width;
+            int v = obj.sub_label, n = 0;
+            char digits[12];
+            do
+            {
+                digits[n++] = '0' + v % 10;
+                v /= 10;
+            } while (v > 0);
+            while (n > 0)
+            {
+                const Glyph &g = char_glyphs[(unsigned char)digits[--n]];
+                blit(image, g, x, y);
+                x += g.area.width;
+            }
+            blit(image, sp, x, y);
+            x += sp.area.width;
+            blit_number(image, cvRound(obj.sub_prob * 1000), x, y);
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "object.h"
+
+// Draws detections straight into a caller-owned frame. Label strings and
+// the characters used for scores are rasterized once into a glyph atlas
+// with cv::putText; per frame the labels are alpha-blitted from the atlas
+// and boxes are filled as row spans, so nothing is re-rasterized and the
+// frame is never copied.
+class OverlayRenderer
+{
+public:
+    OverlayRenderer(const std::vector<std::string> &class_names, double font_scale = 0.5, int thickness = 1);
+
+    // scale maps object coordinates onto image, e.g. for a preview-sized frame
+    void draw(cv::Mat &image, const std::vector<Object> &objects, float scale = 1.f) const;
+
+private:
+    struct Glyph
+    {
+        cv::Rect area; // region of the atlas
+    };
+
+    void blit(cv::Mat &image, const Glyph &g, int x, int y) const;
+    int blit_number(cv::Mat &image, int tenths, int x, int y) const;
+
+    int ascent, line_height;
+    cv::Mat atlas; // CV_8U alpha, one row of glyphs per line_height
+    std::vector<Glyph> label_glyphs;
+    Glyph char_glyphs[128];
+};
+
+// Axis-aligned box outline of the given thickness drawn as row spans.
+void fill_box(cv::Mat &image, const cv::Rect &box, const cv::Vec3b &color, int thickness);
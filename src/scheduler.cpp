@@ -0,0 +1,184 @@
+#include <algorithm>
+#include "scheduler.h"
+
+SplitNcnnBackend::SplitNcnnBackend(const std::string &model_path, const std::string &split_layer, bool int8, int gpu_device)
+    : gpu(model_path, true, int8, gpu_device), cpu(model_path, false, int8), split_layer(split_layer)
+{
+    const std::vector<ncnn::Layer *> &layers = cpu.net.layers();
+    const std::vector<ncnn::Blob> &blobs = cpu.net.blobs();
+    int cut = -1;
+    for (size_t i = 0; i < layers.size(); i++)
+        if (layers[i]->name == split_layer)
+            cut = i;
+    if (cut <= 0)
+    {
+        fprintf(stderr, "[WARN] Split layer %s not found, running everything on the CPU\n", split_layer.c_str());
+        return;
+    }
+
+    // layers are stored in param order, which is topological, so the cut
+    // is crossed by exactly the blobs produced before it and consumed after
+    for (const auto &b : blobs)
+        if (b.producer >= 0 && b.producer < cut && b.consumer >= cut)
+            boundary.push_back(b.name);
+
+    printf("[SPLIT] %s: %zu blobs cross from %s to cpu:", split_layer.c_str(), boundary.size(), gpu.device_name.empty() ? "cpu" : "gpu");
+    for (const auto &b : boundary)
+        printf(" %s", b.c_str());
+    printf("\n");
+}
+
+std::string SplitNcnnBackend::describe() const
+{
+    return "backend=ncnn-split split=" + split_layer + " blobs=" + std::to_string(boundary.size()) + " gpu=[" + gpu.describe() + "] cpu=[" +
+           cpu.describe() + "]";
+}
+
+int SplitNcnnBackend::infer(const ncnn::Mat &in, std::vector<ncnn::Mat> &outs, int num_outputs)
+{
+    if (boundary.empty())
+        return cpu.infer(in, outs, num_outputs);
+
+    std::vector<ncnn::Mat> cut(boundary.size());
+    {
+        ncnn::Extractor ex = gpu.net.create_extractor();
+        ex.input("in0", in);
+        for (size_t i = 0; i < boundary.size(); i++)
+        {
+            int ret = ex.extract(boundary[i].c_str(), cut[i]);
+            if (ret != 0)
+                return ret;
+        }
+    }
+
+    ncnn::Extractor ex = cpu.net.create_extractor();
+    for (size_t i = 0; i < boundary.size(); i++)
+        ex.input(boundary[i].c_str(), cut[i]);
+
+    outs.resize(num_outputs);
+    for (int i = 0; i < num_outputs; i++)
+    {
+        std::string blob = "out" + std::to_string(i);
+        int ret = ex.extract(blob.c_str(), outs[i]);
+        if (ret != 0)
+            return ret;
+    }
+    return 0;
+}
+
+HeteroScheduler::HeteroScheduler(std::vector<std::unique_ptr<YoloV11>> detectors, int max_queued)
+    : max_queued(std::max(max_queued, 0)), start(std::chrono::steady_clock::now())
+{
+    for (auto &d : detectors)
+    {
+        workers.emplace_back(new Worker);
+        workers.back()->yolo = std::move(d);
+        workers.back()->yolo->verbose = false;
+    }
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i]->thread = std::thread(&HeteroScheduler::run, this, (int)i);
+}
+
+HeteroScheduler::~HeteroScheduler()
+{
+    drain();
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        stopping = true;
+        cond.notify_all();
+    }
+    for (auto &w : workers)
+        w->thread.join();
+}
+
+double HeteroScheduler::predicted_ms(const Worker &w, std::chrono::steady_clock::time_point now) const
+{
+    double remaining = 0;
+    if (w.busy)
+        remaining = std::max(0.0, w.ewma_ms - std::chrono::duration<double, std::milli>(now - w.started).count());
+    return remaining + (w.queue.size() + 1) * w.ewma_ms;
+}
+
+int HeteroScheduler::submit(const cv::Mat &bgr, Callback done)
+{
+    std::unique_lock<std::mutex> lk(lock);
+    int best = -1;
+    cond.wait(lk, [&]() {
+        const auto now = std::chrono::steady_clock::now();
+        best = -1;
+        double best_ms = 0;
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            const Worker &w = *workers[i];
+            // an idle worker may always take a frame, otherwise respect the queue bound
+            if (w.busy && (int)w.queue.size() >= max_queued)
+                continue;
+            double ms = predicted_ms(w, now);
+            if (best < 0 || ms < best_ms)
+            {
+                best = i;
+                best_ms = ms;
+            }
+        }
+        return best >= 0;
+    });
+
+    workers[best]->queue.push_back(Job{bgr, std::move(done)});
+    cond.notify_all();
+    return best;
+}
+
+void HeteroScheduler::drain()
+{
+    std::unique_lock<std::mutex> lk(lock);
+    cond.wait(lk, [&]() {
+        for (const auto &w : workers)
+            if (w->busy || !w->queue.empty())
+                return false;
+        return true;
+    });
+}
+
+void HeteroScheduler::run(int index)
+{
+    Worker &w = *workers[index];
+    std::vector<Object> objects;
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lk(lock);
+            cond.wait(lk, [&]() { return stopping || !w.queue.empty(); });
+            if (w.queue.empty())
+                return;
+            job = std::move(w.queue.front());
+            w.queue.pop_front();
+            w.busy = true;
+            w.started = std::chrono::steady_clock::now();
+        }
+
+        w.yolo->detect(job.image, objects);
+        if (job.done)
+            job.done(index, objects);
+
+        std::lock_guard<std::mutex> lk(lock);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - w.started).count();
+        w.ewma_ms = w.frames == 0 ? ms : 0.8 * w.ewma_ms + 0.2 * ms;
+        w.frames++;
+        w.busy_ms += ms;
+        w.busy = false;
+        cond.notify_all();
+    }
+}
+
+void HeteroScheduler::print_stats() const
+{
+    std::lock_guard<std::mutex> lk(lock);
+    double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        const Worker &w = *workers[i];
+        printf("[SCHED] worker %zu %-16s frames=%ld service=%.2f ms (ewma) utilization=%.0f%%  %s\n", i, w.yolo->backend_name(), w.frames,
+               w.ewma_ms, wall_ms > 0 ? 100.0 * w.busy_ms / wall_ms : 0.0, w.yolo->backend_config().c_str());
+    }
+}
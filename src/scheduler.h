@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "backend.h"
+#include "yolo11.h"
+
+// Layer split across devices: the layers before split_layer (in param
+// order) run on the Vulkan device, the rest on the CPU. The blobs crossing
+// the cut are downloaded from the GPU net and fed into a CPU copy of the
+// same model, e.g. GPU backbone and neck, CPU head.
+class SplitNcnnBackend : public InferenceBackend
+{
+public:
+    SplitNcnnBackend(const std::string &model_path, const std::string &split_layer, bool int8 = false, int gpu_device = -1);
+
+    const char *name() const { return "ncnn-split"; }
+    std::string describe() const;
+    int infer(const ncnn::Mat &in, std::vector<ncnn::Mat> &outs, int num_outputs);
+
+private:
+    NcnnBackend gpu, cpu;
+    std::string split_layer;
+    std::vector<std::string> boundary; // blobs produced before the cut and consumed after it
+};
+
+// Runs several detectors (typically one on the CPU and one on the Vulkan
+// device) on their own threads and sends each frame to the one with the
+// lowest predicted completion time: its remaining work plus queued frames
+// times its moving-average service time, plus one more service time.
+// Detectors that have not finished a frame yet predict zero, so every
+// device is measured early. Results may complete out of submission order.
+class HeteroScheduler
+{
+public:
+    // worker index, detections (valid during the call); runs on the worker thread
+    typedef std::function<void(int, const std::vector<Object> &)> Callback;
+
+    // max_queued: frames waiting per detector before submit() blocks
+    HeteroScheduler(std::vector<std::unique_ptr<YoloV11>> detectors, int max_queued = 1);
+    ~HeteroScheduler();
+
+    // Returns the chosen detector index.
+    int submit(const cv::Mat &bgr, Callback done);
+    // Blocks until every submitted frame has completed.
+    void drain();
+
+    void print_stats() const;
+
+private:
+    struct Job
+    {
+        cv::Mat image;
+        Callback done;
+    };
+
+    struct Worker
+    {
+        std::unique_ptr<YoloV11> yolo;
+        std::deque<Job> queue;
+        bool busy = false;
+        std::chrono::steady_clock::time_point started;
+        double ewma_ms = 0;
+        long frames = 0;
+        double busy_ms = 0;
+        std::thread thread;
+    };
+
+    double predicted_ms(const Worker &w, std::chrono::steady_clock::time_point now) const;
+    void run(int index);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    int max_queued;
+    bool stopping = false;
+    mutable std::mutex lock;
+    std::condition_variable cond;
+    std::chrono::steady_clock::time_point start;
+};
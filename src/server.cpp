@@ -0,0 +1,162 @@
+#include <arpa/inet.h>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include "jpeg_stream.h"
+#include "server.h"
+
+bool read_full(int fd, void *buf, size_t size)
+{
+    char *p = (char *)buf;
+    while (size > 0)
+    {
+        ssize_t n = read(fd, p, size);
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool write_full(int fd, const void *buf, size_t size)
+{
+    const char *p = (const char *)buf;
+    while (size > 0)
+    {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+namespace {
+
+struct Job
+{
+    std::vector<uchar> jpeg;
+    std::promise<std::vector<WireDetection>> result;
+};
+
+class JobQueue
+{
+public:
+    void push(Job *job)
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        jobs.push_back(job);
+        cond.notify_one();
+    }
+
+    Job *pop()
+    {
+        std::unique_lock<std::mutex> lk(lock);
+        cond.wait(lk, [&]() { return !jobs.empty(); });
+        Job *job = jobs.front();
+        jobs.pop_front();
+        return job;
+    }
+
+private:
+    std::mutex lock;
+    std::condition_variable cond;
+    std::deque<Job *> jobs;
+};
+
+} // namespace
+
+static void serve_connection(int fd, JobQueue &queue)
+{
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    for (;;)
+    {
+        uint32_t size = 0;
+        if (!read_full(fd, &size, sizeof(size)) || size == 0 || size > (64u << 20))
+            break;
+
+        Job job;
+        job.jpeg.resize(size);
+        if (!read_full(fd, job.jpeg.data(), size))
+            break;
+
+        std::future<std::vector<WireDetection>> done = job.result.get_future();
+        queue.push(&job);
+        std::vector<WireDetection> dets = done.get();
+
+        uint32_t count = dets.size();
+        if (!write_full(fd, &count, sizeof(count)) || !write_full(fd, dets.data(), count * sizeof(WireDetection)))
+            break;
+    }
+    close(fd);
+}
+
+int run_server(YoloV11 &yolo, const std::string &bind_addr, int port, bool stream_decode)
+{
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, bind_addr.c_str(), &addr.sin_addr) != 1 || bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 64) != 0)
+    {
+        perror("bind");
+        close(listen_fd);
+        return -1;
+    }
+    printf("[INFO] Serving on %s:%d\n", bind_addr.c_str(), port);
+
+    JobQueue queue;
+    std::thread worker([&]() {
+        DetectionSet dets;
+        for (;;)
+        {
+            Job *job = queue.pop();
+            std::vector<WireDetection> out;
+            cv::Mat img;
+            cv::Size full;
+            const bool fitted = stream_decode && decode_jpeg_fit(job->jpeg.data(), job->jpeg.size(), TARGET_SIZE, img, full);
+            if (!fitted)
+                img = cv::imdecode(job->jpeg, cv::IMREAD_COLOR);
+            if (!img.empty() && yolo.detect(img, dets) == 0)
+            {
+                if (fitted)
+                    dets.remap(0.f, 0.f, (float)img.cols / full.width, (float)img.rows / full.height, full.width, full.height);
+                out.resize(dets.size());
+                for (int i = 0; i < dets.size(); i++)
+                {
+                    DetectionSet::Detection d = dets[i];
+                    out[i] = {d.x0, d.y0, d.x1, d.y1, d.score, d.label};
+                }
+            }
+            job->result.set_value(std::move(out));
+        }
+    });
+    worker.detach();
+
+    for (;;)
+    {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        std::thread(serve_connection, fd, std::ref(queue)).detach();
+    }
+    return 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "yolo11.h"
+
+// Wire format, native byte order (local use):
+//   request:  uint32 size, size bytes of JPEG
+//   response: uint32 count, count x WireDetection
+// Each connection is served one request at a time: the next request is read
+// only after the previous response was written. A client may send ahead
+// (the socket buffers it), but only separate connections reach the
+// detector queue concurrently.
+struct WireDetection
+{
+    float x0, y0, x1, y1;
+    float score;
+    int32_t label;
+};
+
+bool read_full(int fd, void *buf, size_t size);
+bool write_full(int fd, const void *buf, size_t size);
+
+// Accepts connections on bind_addr:port and serves them with one detector
+// thread fed by a FIFO queue shared by all connections. Runs until killed.
+// With stream_decode, large JPEGs are decoded straight to the network
+// input size (see jpeg_stream.h); boxes are still in request coordinates.
+int run_server(YoloV11 &yolo, const std::string &bind_addr, int port, bool stream_decode = false);
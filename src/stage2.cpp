@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include "stage2.h"
+
+CropClassifier::CropClassifier(const std::string &model_path, int input_w, int input_h, Mode mode, const std::vector<int> &labels, int num_threads)
+    : input_w(input_w), input_h(input_h), mode(mode), labels(labels), num_threads(num_threads)
+{
+    // parallelism comes from running crops side by side, not inside a layer
+    net.opt.num_threads = 1;
+    net.opt.use_vulkan_compute = false;
+    net.opt.use_packing_layout = true;
+    net.opt.use_fp16_arithmetic = true;
+
+    net.load_param((model_path + ".param").c_str());
+    net.load_model((model_path + ".bin").c_str());
+    printf("[CONFIG] stage2=%s input=%dx%d mode=%s\n", model_path.c_str(), input_w, input_h, mode == EMBED ? "embed" : "classify");
+}
+
+bool CropClassifier::wanted(int label) const
+{
+    return labels.empty() || std::find(labels.begin(), labels.end(), label) != labels.end();
+}
+
+void CropClassifier::collect(const cv::Mat &bgr, int frame, std::vector<Object> &objects)
+{
+    for (auto &obj : objects)
+    {
+        obj.sub_label = -1;
+        obj.sub_prob = 0.f;
+        obj.embedding.clear();
+
+        cv::Rect roi = cv::Rect(obj.rect) & cv::Rect(0, 0, bgr.cols, bgr.rows);
+        if (!wanted(obj.label) || roi.width < 2 || roi.height < 2)
+            continue;
+        crops.push_back({frame, &obj});
+    }
+}
+
+int CropClassifier::run(const std::vector<cv::Mat> &frames)
+{
+    const int n = crops.size();
+    if (n == 0)
+        return 0;
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    // ncnn has no batch dimension: each crop is resized straight into its
+    // own input, which its extractor reads as is
+    if ((int)inputs.size() < n)
+        inputs.resize(n);
+
+    const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
+
+#pragma omp parallel for num_threads(num_threads)
+    for (int i = 0; i < n; i++)
+    {
+        const cv::Mat &bgr = frames[crops[i].frame];
+        cv::Rect roi = cv::Rect(crops[i].obj->rect) & cv::Rect(0, 0, bgr.cols, bgr.rows);
+
+        inputs[i] = ncnn::Mat::from_pixels_roi_resize(bgr.data, ncnn::Mat::PIXEL_BGR2RGB, bgr.cols, bgr.rows, (int)bgr.step, roi.x, roi.y,
+                                                      roi.width, roi.height, input_w, input_h);
+        inputs[i].substract_mean_normalize(0, norm_vals);
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    int failed = 0;
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic) reduction(+ : failed)
+    for (int i = 0; i < n; i++)
+    {
+        ncnn::Extractor ex = net.create_extractor();
+        ex.input("in0", inputs[i]);
+        ncnn::Mat out;
+        if (ex.extract("out0", out) != 0 || out.empty())
+        {
+            // the object keeps sub_label -1 and no embedding
+            failed++;
+            continue;
+        }
+
+        const float *p = out;
+        const int len = out.w * out.h * out.c;
+        Object &obj = *crops[i].obj;
+        if (mode == EMBED)
+        {
+            float sum = 0.f;
+            for (int k = 0; k < len; k++)
+                sum += p[k] * p[k];
+            const float inv = sum > 0.f ? 1.f / sqrtf(sum) : 0.f;
+            obj.embedding.resize(len);
+            for (int k = 0; k < len; k++)
+                obj.embedding[k] = p[k] * inv;
+        }
+        else
+        {
+            // softmax probability of the top logit
+            const float *max_p = std::max_element(p, p + len);
+            float sum = 0.f;
+            for (int k = 0; k < len; k++)
+                sum += expf(p[k] - *max_p);
+            obj.sub_label = max_p - p;
+            obj.sub_prob = 1.f / sum;
+        }
+    }
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> crop_ms = t1 - t0;
+    std::chrono::duration<double, std::milli> infer_ms = t2 - t1;
+    printf("[TIME] Stage2 crops=%d | Crop: %.2f ms | Inference: %.2f ms\n", n, crop_ms.count(), infer_ms.count());
+    if (failed)
+        fprintf(stderr, "[WARN] Stage2 inference failed for %d of %d crops\n", failed, n);
+
+    crops.clear();
+    return 0;
+}
+
+int CropClassifier::classify(const cv::Mat &bgr, std::vector<Object> &objects)
+{
+    crops.clear();
+    collect(bgr, 0, objects);
+    return run(std::vector<cv::Mat>{bgr});
+}
+
+int CropClassifier::classify(const std::vector<cv::Mat> &frames, std::vector<std::vector<Object>> &objects)
+{
+    crops.clear();
+    for (size_t f = 0; f < frames.size() && f < objects.size(); f++)
+        collect(frames[f], f, objects[f]);
+    return run(frames);
+}
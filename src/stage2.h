@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "net.h"
+#include "object.h"
+
+// Second-stage network run on detector crops (attribute classifier or
+// re-ID embedding). All crops of a frame, or of several frames, are
+// processed as one batch, but not as one tensor: ncnn has no batch
+// dimension, so a stacked tensor would only be sliced back into per-crop
+// inputs. Instead the crops are resized in parallel, each into its own
+// input, and inferred with one single-threaded extractor per crop. The cost
+// grows with the number of cores rather than serially with the number of
+// objects. A crop whose inference fails keeps sub_label -1 and no
+// embedding.
+class CropClassifier
+{
+public:
+    enum Mode
+    {
+        CLASSIFY = 0, // argmax of the output logits -> Object::sub_label, its softmax probability -> sub_prob
+        EMBED = 1     // L2-normalized output -> Object::embedding
+    };
+
+    CropClassifier(const std::string &model_path, int input_w, int input_h, Mode mode = CLASSIFY,
+                   const std::vector<int> &labels = {0}, int num_threads = 3);
+
+    int classify(const cv::Mat &bgr, std::vector<Object> &objects);
+    int classify(const std::vector<cv::Mat> &frames, std::vector<std::vector<Object>> &objects);
+
+private:
+    struct Crop
+    {
+        int frame;
+        Object *obj;
+    };
+
+    bool wanted(int label) const;
+    void collect(const cv::Mat &bgr, int frame, std::vector<Object> &objects);
+    int run(const std::vector<cv::Mat> &frames);
+
+    ncnn::Net net;
+    int input_w, input_h;
+    Mode mode;
+    std::vector<int> labels;
+    int num_threads;
+
+    std::vector<Crop> crops;
+    std::vector<ncnn::Mat> inputs; // one per crop of the current run
+};
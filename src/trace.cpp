@@ -0,0 +1,316 @@
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "async_io.h"
+#include "benchmark.h"
+#include "trace.h"
+
+bool load_trace(const std::string &dir, Trace &trace)
+{
+    std::ifstream f(dir + "/trace.csv");
+    if (!f)
+        return false;
+
+    trace = Trace();
+    trace.dir = dir;
+    for (std::string line; std::getline(f, line);)
+    {
+        if (line.empty())
+            continue;
+        size_t comma = line.find(',');
+        if (comma == std::string::npos)
+            continue;
+        std::string key = line.substr(0, comma), value = line.substr(comma + 1);
+        if (key == "video")
+        {
+            trace.video = value;
+            continue;
+        }
+
+        TraceFrame fr;
+        fr.arrival_us = std::stoll(key);
+        if (!value.empty() && value[0] == '#')
+            fr.video_frame = std::stoi(value.substr(1));
+        else
+            fr.file = value;
+        trace.frames.push_back(fr);
+    }
+    return !trace.frames.empty();
+}
+
+bool save_trace(const Trace &trace)
+{
+    std::ofstream f(trace.dir + "/trace.csv");
+    if (!f)
+        return false;
+    if (!trace.video.empty())
+        f << "video," << trace.video << "\n";
+    for (const auto &fr : trace.frames)
+    {
+        if (fr.video_frame >= 0)
+            f << fr.arrival_us << ",#" << fr.video_frame << "\n";
+        else
+            f << fr.arrival_us << "," << fr.file << "\n";
+    }
+    return true;
+}
+
+bool open_source(cv::VideoCapture &cap, const std::string &source)
+{
+    if (!source.empty() && source.find_first_not_of("0123456789") == std::string::npos)
+        return cap.open(std::stoi(source));
+    return cap.open(source);
+}
+
+int record_trace(const std::string &source, const std::string &dir, int max_frames, bool reference_only)
+{
+    cv::VideoCapture cap;
+    if (!open_source(cap, source))
+    {
+        fprintf(stderr, "Failed to open source: %s\n", source.c_str());
+        return -1;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+
+    Trace trace;
+    trace.dir = dir;
+    if (reference_only)
+        trace.video = source;
+
+    // Frames are encoded and written on a writer thread, so the capture loop
+    // only reads and timestamps. When the writer falls behind by more than
+    // max_pending frames the new frame is dropped, as the camera would drop
+    // it, instead of letting memory grow.
+    const size_t max_pending = 120;
+    std::mutex lock;
+    std::condition_variable cond;
+    std::deque<std::pair<std::string, cv::Mat>> pending;
+    bool done = false;
+    int dropped = 0;
+    std::thread writer;
+    if (!reference_only)
+    {
+        writer = std::thread([&]() {
+            AsyncFileIO io;
+            for (;;)
+            {
+                std::pair<std::string, cv::Mat> job;
+                {
+                    std::unique_lock<std::mutex> lk(lock);
+                    cond.wait(lk, [&]() { return done || !pending.empty(); });
+                    if (pending.empty())
+                        break;
+                    job = std::move(pending.front());
+                    pending.pop_front();
+                }
+                std::vector<unsigned char> jpg;
+                cv::imencode(".jpg", job.second, jpg);
+                io.write(dir + "/" + job.first, std::move(jpg));
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; max_frames <= 0 || i < max_frames; i++)
+    {
+        // a fresh Mat per frame, the queued ones must not be overwritten
+        cv::Mat frame;
+        if (!cap.read(frame))
+            break;
+
+        TraceFrame fr;
+        if (reference_only)
+        {
+            // a file has no live arrival time, use its presentation time
+            fr.arrival_us = (int64_t)(cap.get(cv::CAP_PROP_POS_MSEC) * 1000);
+            fr.video_frame = i;
+        }
+        else
+        {
+            fr.arrival_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+            char name[32];
+            snprintf(name, sizeof(name), "%06d.jpg", i);
+            fr.file = name;
+            std::lock_guard<std::mutex> lk(lock);
+            if (pending.size() >= max_pending)
+            {
+                dropped++;
+                continue;
+            }
+            pending.emplace_back(fr.file, std::move(frame));
+            cond.notify_one();
+        }
+        trace.frames.push_back(fr);
+    }
+
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            done = true;
+            cond.notify_one();
+        }
+        writer.join();
+    }
+    if (dropped)
+        fprintf(stderr, "[WARN] Writer fell behind, %d frames dropped\n", dropped);
+
+    if (trace.frames.empty() || !save_trace(trace))
+    {
+        fprintf(stderr, "Failed to record trace into %s\n", dir.c_str());
+        return -1;
+    }
+    printf("[INFO] Recorded %zu frames into %s/trace.csv\n", trace.frames.size(), dir.c_str());
+    return 0;
+}
+
+namespace {
+
+struct QueuedFrame
+{
+    cv::Mat image;
+    std::chrono::steady_clock::time_point arrival;
+};
+
+} // namespace
+
+// Producer side shared by both replay variants. process() consumes each
+// dequeued frame on the calling thread, finish() waits for frames still in
+// flight before the wall time is taken.
+static void replay(const Trace &trace, double speed, int queue_depth, ReplayReport &report,
+                 const std::function<void(QueuedFrame &)> &process, const std::function<void()> &finish)
+{
+    report.frames = trace.frames.size();
+
+    std::mutex lock;
+    std::condition_variable cond;
+    std::deque<QueuedFrame> queue;
+    bool done = false;
+
+    cv::VideoCapture cap;
+    if (!trace.video.empty() && !cap.open(trace.video))
+    {
+        fprintf(stderr, "Failed to open trace video: %s\n", trace.video.c_str());
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([&]() {
+        int video_pos = 0;
+        const int64_t first_us = trace.frames.empty() ? 0 : trace.frames[0].arrival_us;
+        for (const auto &fr : trace.frames)
+        {
+            QueuedFrame q;
+            if (fr.video_frame >= 0)
+            {
+                while (video_pos <= fr.video_frame && cap.read(q.image))
+                    video_pos++;
+            }
+            else
+            {
+                q.image = cv::imread(trace.dir + "/" + fr.file);
+            }
+            if (q.image.empty())
+                continue;
+
+            // Latency counts from when the frame was due, not from when it was
+            // queued: a decode that overruns the gap delays the frame as
+            // a slow camera feed would, and that wait is part of the
+            // latency (no coordinated omission). At max speed every frame
+            // is due at the start.
+            q.arrival = start;
+            if (speed > 0)
+            {
+                q.arrival = start + std::chrono::microseconds((int64_t)((fr.arrival_us - first_us) / speed));
+                std::this_thread::sleep_until(q.arrival);
+            }
+
+            std::unique_lock<std::mutex> lk(lock);
+            if (speed <= 0)
+            {
+                // max speed: block instead of dropping, we only want throughput
+                cond.wait(lk, [&]() { return (int)queue.size() < queue_depth; });
+            }
+            else if ((int)queue.size() >= queue_depth)
+            {
+                queue.pop_front();
+                report.dropped++;
+            }
+            queue.push_back(std::move(q));
+            cond.notify_all();
+        }
+        std::lock_guard<std::mutex> lk(lock);
+        done = true;
+        cond.notify_all();
+    });
+
+    for (;;)
+    {
+        QueuedFrame q;
+        {
+            std::unique_lock<std::mutex> lk(lock);
+            cond.wait(lk, [&]() { return done || !queue.empty(); });
+            if (queue.empty())
+                break;
+            q = std::move(queue.front());
+            queue.pop_front();
+            cond.notify_all();
+        }
+
+        process(q);
+    }
+
+    producer.join();
+    finish();
+    report.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+ReplayReport replay_trace(YoloV11 &yolo, const Trace &trace, double speed, int queue_depth)
+{
+    ReplayReport report;
+    std::vector<Object> objects;
+    auto process = [&](QueuedFrame &q) {
+        yolo.detect(q.image, objects);
+        auto end = std::chrono::steady_clock::now();
+        report.latency_ms.push_back(std::chrono::duration<double, std::milli>(end - q.arrival).count());
+        report.processed++;
+    };
+    replay(trace, speed, queue_depth, report, process, []() {});
+    return report;
+}
+
+ReplayReport replay_trace(HeteroScheduler &sched, const Trace &trace, double speed, int queue_depth)
+{
+    ReplayReport report;
+    std::mutex report_lock;
+    // submit() blocks while every detector is saturated, so frames back up
+    // into the replay queue and get dropped there, as with one detector
+    auto process = [&](QueuedFrame &q) {
+        auto arrival = q.arrival;
+        sched.submit(q.image, [&report, &report_lock, arrival](int, const std::vector<Object> &) {
+            auto end = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lk(report_lock);
+            report.latency_ms.push_back(std::chrono::duration<double, std::milli>(end - arrival).count());
+            report.processed++;
+        });
+    };
+    replay(trace, speed, queue_depth, report, process, [&]() { sched.drain(); });
+    return report;
+}
+
+void print_replay_report(const ReplayReport &report)
+{
+    StageStats s = compute_stats(report.latency_ms);
+    printf("[REPLAY] frames=%d processed=%d dropped=%d (%.1f%%) wall=%.2f s throughput=%.1f fps\n", report.frames, report.processed,
+           report.dropped, report.frames ? 100.0 * report.dropped / report.frames : 0.0, report.wall_s,
+           report.wall_s > 0 ? report.processed / report.wall_s : 0.0);
+    printf("[REPLAY] latency ms: mean=%.2f p50=%.2f p90=%.2f p99=%.2f max=%.2f\n", s.mean, s.p50, s.p90, s.p99, s.max);
+}
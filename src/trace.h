@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "scheduler.h"
+#include "yolo11.h"
+
+// One captured frame: when it arrived (microseconds from the first frame)
+// and where its pixels are, either a JPEG inside the trace directory or a
+// frame index into the trace's reference video.
+struct TraceFrame
+{
+    int64_t arrival_us;
+    std::string file;
+    int video_frame = -1;
+};
+
+// A trace directory holds trace.csv plus the recorded JPEGs. The first line
+// may be "video,<path>" when frames are references into a video file.
+struct Trace
+{
+    std::string dir;
+    std::string video;
+    std::vector<TraceFrame> frames;
+};
+
+bool load_trace(const std::string &dir, Trace &trace);
+bool save_trace(const Trace &trace);
+
+// source is a camera index (a bare number), device, stream URL or video file
+bool open_source(cv::VideoCapture &cap, const std::string &source);
+
+// Captures up to max_frames from source (camera index, device, stream URL
+// or video file) with their arrival times. JPEG encoding and writing run on
+// a writer thread so they do not delay the next capture. With
+// reference_only the source must be a video file and only frame indices
+// are stored.
+int record_trace(const std::string &source, const std::string &dir, int max_frames, bool reference_only);
+
+struct ReplayReport
+{
+    int frames = 0;
+    int processed = 0;
+    int dropped = 0;
+    double wall_s = 0;
+    std::vector<double> latency_ms; // scheduled arrival (start at max speed) -> detections ready
+};
+
+// Feeds the trace through a capture thread and a detector thread joined by
+// a queue of queue_depth frames; when the detector falls behind the oldest
+// queued frame is dropped, as a camera would. speed scales the original
+// inter-arrival gaps (2 = twice as fast), 0 replays as fast as possible.
+ReplayReport replay_trace(YoloV11 &yolo, const Trace &trace, double speed, int queue_depth = 2);
+// Same, with the scheduler's detectors consuming the queue in parallel.
+ReplayReport replay_trace(HeteroScheduler &sched, const Trace &trace, double speed, int queue_depth = 2);
+
+void print_replay_report(const ReplayReport &report);
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include "weight_pack.h"
+
+#if YOLONCNN_ZSTD
+#include <zstd.h>
+#endif
+
+static const char PACK_MAGIC[4] = {'Y', 'N', 'Z', '1'};
+
+bool load_packed_model(ncnn::Net &net, const std::string &path, std::vector<unsigned char> &weights)
+{
+#if YOLONCNN_ZSTD
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    // one sequential read of the compressed file, the storage is the bottleneck
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp)
+        return false;
+    std::vector<unsigned char> file;
+    fseek(fp, 0, SEEK_END);
+    file.resize(ftell(fp));
+    fseek(fp, 0, SEEK_SET);
+    bool ok = fread(file.data(), 1, file.size(), fp) == file.size();
+    fclose(fp);
+
+    WeightPackHeader hdr;
+    if (!ok || file.size() < sizeof(hdr))
+        return false;
+    memcpy(&hdr, file.data(), sizeof(hdr));
+    if (memcmp(hdr.magic, PACK_MAGIC, 4) != 0 || hdr.block_size == 0)
+    {
+        fprintf(stderr, "[ERROR] %s is not a packed model\n", path.c_str());
+        return false;
+    }
+
+    // Every size comes from the file, so check them before anything is
+    // allocated or decompressed: the blocks must tile bin_size exactly (each
+    // one then decompresses inside weights) and the size table, param text
+    // and blocks must lie inside the file.
+    const uint64_t file_size = file.size();
+    size_t pos = sizeof(hdr);
+    if (hdr.bin_size / hdr.block_size + (hdr.bin_size % hdr.block_size != 0) != hdr.block_count ||
+        (uint64_t)hdr.block_count * sizeof(uint32_t) + hdr.param_size > file_size - pos)
+    {
+        fprintf(stderr, "[ERROR] %s: inconsistent header\n", path.c_str());
+        return false;
+    }
+    std::vector<uint32_t> sizes(hdr.block_count);
+    std::vector<size_t> offsets(hdr.block_count);
+    memcpy(sizes.data(), file.data() + pos, hdr.block_count * sizeof(uint32_t));
+    pos += hdr.block_count * sizeof(uint32_t);
+    std::string param((const char *)file.data() + pos, hdr.param_size);
+    pos += hdr.param_size;
+    for (uint32_t i = 0; i < hdr.block_count; i++)
+    {
+        offsets[i] = pos;
+        if (sizes[i] > file_size - pos)
+        {
+            fprintf(stderr, "[ERROR] %s: block %u runs past the end of the file\n", path.c_str(), i);
+            return false;
+        }
+        pos += sizes[i];
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    weights.resize(hdr.bin_size);
+    int failed = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+ : failed)
+    for (int i = 0; i < (int)hdr.block_count; i++)
+    {
+        size_t begin = (size_t)i * hdr.block_size;
+        size_t expect = std::min((size_t)hdr.block_size, (size_t)hdr.bin_size - begin);
+        size_t got = ZSTD_decompress(weights.data() + begin, expect, file.data() + offsets[i], sizes[i]);
+        if (ZSTD_isError(got) || got != expect)
+            failed++;
+    }
+    if (failed)
+    {
+        fprintf(stderr, "[ERROR] %d corrupt blocks in %s\n", failed, path.c_str());
+        return false;
+    }
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    if (net.load_param_mem(param.c_str()) != 0 || net.load_model(weights.data()) <= 0)
+        return false;
+
+    auto t3 = std::chrono::high_resolution_clock::now();
+    printf("[LOAD] %s: %zu -> %llu bytes in %u blocks, read %.1f ms, decompress %.1f ms, load %.1f ms\n", path.c_str(), file.size(),
+           (unsigned long long)hdr.bin_size, hdr.block_count, std::chrono::duration<double, std::milli>(t1 - t0).count(),
+           std::chrono::duration<double, std::milli>(t2 - t1).count(), std::chrono::duration<double, std::milli>(t3 - t2).count());
+    return true;
+#else
+    (void)net;
+    (void)weights;
+    fprintf(stderr, "[ERROR] %s: built without zstd, packed models are unavailable\n", path.c_str());
+    return false;
+#endif
+}
+
+bool save_packed_model(const std::string &path, const std::string &param, const std::vector<unsigned char> &bin, int level, uint32_t block_size)
+{
+#if YOLONCNN_ZSTD
+    WeightPackHeader hdr;
+    memcpy(hdr.magic, PACK_MAGIC, 4);
+    hdr.param_size = param.size();
+    hdr.bin_size = bin.size();
+    hdr.block_size = block_size;
+    hdr.block_count = (bin.size() + block_size - 1) / block_size;
+
+    std::vector<std::vector<unsigned char>> blocks(hdr.block_count);
+    int failed = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+ : failed)
+    for (int i = 0; i < (int)hdr.block_count; i++)
+    {
+        size_t begin = (size_t)i * block_size;
+        size_t len = std::min((size_t)block_size, bin.size() - begin);
+        blocks[i].resize(ZSTD_compressBound(len));
+        size_t n = ZSTD_compress(blocks[i].data(), blocks[i].size(), bin.data() + begin, len, level);
+        if (ZSTD_isError(n))
+            failed++;
+        else
+            blocks[i].resize(n);
+    }
+    if (failed)
+        return false;
+
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (!fp)
+        return false;
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    for (const auto &b : blocks)
+    {
+        uint32_t size = b.size();
+        ok &= fwrite(&size, sizeof(size), 1, fp) == 1;
+    }
+    ok &= fwrite(param.data(), 1, param.size(), fp) == param.size();
+    for (const auto &b : blocks)
+        ok &= fwrite(b.data(), 1, b.size(), fp) == b.size();
+    ok &= fclose(fp) == 0;
+    return ok;
+#else
+    (void)param;
+    (void)bin;
+    (void)level;
+    (void)block_size;
+    fprintf(stderr, "[ERROR] %s: built without zstd, packed models are unavailable\n", path.c_str());
+    return false;
+#endif
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "net.h"
+
+// Packed model container (.ncnnz): the .param text and the .bin split into
+// independently zstd-compressed blocks, so loading reads fewer bytes from
+// slow storage and decompresses the blocks on all cores.
+//
+//   WeightPackHeader
+//   uint32 compressed size of each block
+//   param text (param_size bytes)
+//   compressed blocks
+struct WeightPackHeader
+{
+    char magic[4]; // "YNZ1"
+    uint32_t param_size;
+    uint64_t bin_size;
+    uint32_t block_size;
+    uint32_t block_count;
+};
+
+// Loads a container into net. The decompressed weights end up in weights,
+// which ncnn may reference directly, so it must outlive net.
+bool load_packed_model(ncnn::Net &net, const std::string &path, std::vector<unsigned char> &weights);
+
+// Writes param text and .bin bytes as a container, compressing blocks in
+// parallel at the given zstd level.
+bool save_packed_model(const std::string &path, const std::string &param, const std::vector<unsigned char> &bin, int level = 19,
+                       uint32_t block_size = 256 * 1024);
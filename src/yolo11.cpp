@@ -1,271 +1,470 @@
-#include <memory>
-#include <vector>
 #include <algorithm>
 #include <chrono>
-#include <iostream>
+#include <float.h>
+#include <math.h>
 #include "layer.h"
 #include "net.h"
-#include <opencv2/opencv.hpp>
-#include <float.h>
+#include "downscale.h"
+#include "yolo11.h"
 
-#define MAX_STRIDE 32
+static inline float clampf(float d, float min, float max)
+{
+    return std::max(min, std::min(max, d));
+}
 
-struct Object
+// Gaussian covariance (a, b, c) of an oriented box, see probiou below
+static inline void obb_covariance(const cv::RotatedRect &r, float &a, float &b, float &c)
 {
-    cv::Rect_<float> rect;
-    int label;
-    float prob;
-};
+    const float w2 = r.size.width * r.size.width / 12.f;
+    const float h2 = r.size.height * r.size.height / 12.f;
+    const float theta = r.angle * (float)CV_PI / 180.f;
+    const float cs = cosf(theta), sn = sinf(theta);
+    a = w2 * cs * cs + h2 * sn * sn;
+    b = w2 * sn * sn + h2 * cs * cs;
+    c = (w2 - h2) * cs * sn;
+}
 
-static inline float intersection_area(const Object &a, const Object &b)
+// Probabilistic IoU (1 - Hellinger distance between the boxes' Gaussians),
+// the overlap measure YOLO11-OBB is trained and NMS'd with
+static inline float probiou(const cv::RotatedRect &r1, const float *cov1, const cv::RotatedRect &r2, const float *cov2)
 {
-    cv::Rect_<float> inter = a.rect & b.rect;
-    return inter.area();
+    const float eps = 1e-7f;
+    const float a = cov1[0] + cov2[0], b = cov1[1] + cov2[1], c = cov1[2] + cov2[2];
+    const float dx = r1.center.x - r2.center.x, dy = r1.center.y - r2.center.y;
+    const float denom = a * b - c * c + eps;
+    const float t1 = (a * dy * dy + b * dx * dx) / denom * 0.25f;
+    const float t2 = (c * -dx * dy) / denom * 0.5f;
+    const float det1 = std::max(cov1[0] * cov1[1] - cov1[2] * cov1[2], 0.f);
+    const float det2 = std::max(cov2[0] * cov2[1] - cov2[2] * cov2[2], 0.f);
+    const float t3 = logf((a * b - c * c) / (4.f * sqrtf(det1 * det2) + eps) + eps) * 0.5f;
+    const float bd = clampf(t1 + t2 + t3, eps, 100.f);
+    const float hd = sqrtf(1.f - expf(-bd) + eps);
+    return 1.f - hd;
 }
 
-static void qsort_descent_inplace(std::vector<Object> &objects, int left, int right)
+void PostprocessScratch::reserve(int capacity)
 {
-    int i = left, j = right;
-    float p = objects[(left + right) / 2].prob;
-    while (i <= j)
-    {
-        while (objects[i].prob > p)
-            i++;
-        while (objects[j].prob < p)
-            j--;
-        if (i <= j)
-            std::swap(objects[i++], objects[j--]);
-    }
-#pragma omp parallel sections
-    {
-#pragma omp section
-        if (left < j)
-            qsort_descent_inplace(objects, left, j);
-#pragma omp section
-        if (i < right)
-            qsort_descent_inplace(objects, i, right);
-    }
+    if (capacity <= (int)best.size())
+        return;
+    best.resize(capacity);
+    best_label.resize(capacity);
+    kx0.resize(capacity);
+    ky0.resize(capacity);
+    kx1.resize(capacity);
+    ky1.resize(capacity);
+    karea.resize(capacity);
+    klabel.resize(capacity);
+    covs.resize(capacity * 3);
+    picked.reserve(capacity);
 }
 
-static void qsort_descent_inplace(std::vector<Object> &objects)
+// Greedy NMS over score-sorted detections. Kept boxes are packed into
+// their own arrays so the inner loop is a branch-free sweep the compiler
+// can vectorize.
+static void nms_sorted_bboxes(const DetectionSet &dets, PostprocessScratch &scratch, float nms_threshold, bool agnostic = false)
 {
-    if (!objects.empty())
-        qsort_descent_inplace(objects, 0, objects.size() - 1);
+    std::vector<int> &picked = scratch.picked;
+    picked.clear();
+    const int n = dets.size();
+    const float *x0 = dets.x0(), *y0 = dets.y0(), *x1 = dets.x1(), *y1 = dets.y1();
+    const int *label = dets.label();
+
+    scratch.reserve(n);
+    float *kx0 = scratch.kx0.data(), *ky0 = scratch.ky0.data(), *kx1 = scratch.kx1.data(), *ky1 = scratch.ky1.data();
+    float *karea = scratch.karea.data();
+    int *klabel = scratch.klabel.data();
+    int kept = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        const float area = (x1[i] - x0[i]) * (y1[i] - y0[i]);
+        float max_iou = 0.f;
+        for (int k = 0; k < kept; k++)
+        {
+            float iw = std::max(0.f, std::min(x1[i], kx1[k]) - std::max(x0[i], kx0[k]));
+            float ih = std::max(0.f, std::min(y1[i], ky1[k]) - std::max(y0[i], ky0[k]));
+            float inter_area = iw * ih;
+            float iou = inter_area / (area + karea[k] - inter_area);
+            bool same = agnostic || klabel[k] == label[i];
+            max_iou = (same && iou > max_iou) ? iou : max_iou;
+        }
+        if (max_iou > nms_threshold)
+            continue;
+
+        kx0[kept] = x0[i];
+        ky0[kept] = y0[i];
+        kx1[kept] = x1[i];
+        ky1[kept] = y1[i];
+        karea[kept] = area;
+        klabel[kept] = label[i];
+        kept++;
+        picked.push_back(i);
+    }
 }
 
-static void nms_sorted_bboxes(const std::vector<Object> &faceobjects, std::vector<int> &picked, float nms_threshold, bool agnostic = false)
+// Same greedy scheme for oriented boxes (obbs aligned with dets). The
+// axis-aligned bounds reject disjoint pairs first, so probiou only runs for
+// boxes that can overlap.
+static void nms_sorted_rotated(const DetectionSet &dets, const std::vector<cv::RotatedRect> &obbs, PostprocessScratch &scratch, float nms_threshold, bool agnostic = false)
 {
+    std::vector<int> &picked = scratch.picked;
     picked.clear();
-    const int n = faceobjects.size();
-    std::vector<float> areas(n);
+    const int n = dets.size();
+    const float *x0 = dets.x0(), *y0 = dets.y0(), *x1 = dets.x1(), *y1 = dets.y1();
+    const int *label = dets.label();
+    scratch.reserve(n);
+    float *covs = scratch.covs.data();
     for (int i = 0; i < n; i++)
-        areas[i] = faceobjects[i].rect.area();
+        obb_covariance(obbs[i], covs[i * 3], covs[i * 3 + 1], covs[i * 3 + 2]);
 
     for (int i = 0; i < n; i++)
     {
-        const Object &a = faceobjects[i];
         int keep = 1;
         for (int j : picked)
         {
-            const Object &b = faceobjects[j];
-            if (!agnostic && a.label != b.label)
+            if (!agnostic && label[i] != label[j])
+                continue;
+            if (std::min(x1[i], x1[j]) <= std::max(x0[i], x0[j]) || std::min(y1[i], y1[j]) <= std::max(y0[i], y0[j]))
                 continue;
-            float inter_area = intersection_area(a, b);
-            float union_area = areas[i] + areas[j] - inter_area;
-            if (inter_area / union_area > nms_threshold)
+            if (probiou(obbs[i], &covs[i * 3], obbs[j], &covs[j * 3]) > nms_threshold)
+            {
                 keep = 0;
+                break;
+            }
         }
         if (keep)
             picked.push_back(i);
     }
 }
 
-static inline float clampf(float d, float min, float max)
+// Reads the head channel-major: a running max over the class rows keeps
+// every inner loop contiguous, and only anchors above the threshold are
+// appended to dets.
+static void parse_yolov11_detections(const ncnn::Mat &out, float conf_thres, int num_labels, int img_w, int img_h, DetectionSet &dets,
+                                     PostprocessScratch &scratch)
 {
-    return std::max(min, std::min(max, d));
+    const int num_anchors = out.w;
+    dets.clear();
+    dets.reserve(num_anchors);
+    scratch.reserve(num_anchors);
+
+    float *best = scratch.best.data();
+    int *best_label = scratch.best_label.data();
+    std::copy(out.row(4), out.row(4) + num_anchors, best);
+    std::fill(best_label, best_label + num_anchors, 0);
+    for (int k = 1; k < num_labels; k++)
+    {
+        const float *cls = out.row(4 + k);
+        for (int i = 0; i < num_anchors; i++)
+        {
+            best_label[i] = cls[i] > best[i] ? k : best_label[i];
+            best[i] = std::max(best[i], cls[i]);
+        }
+    }
+
+    const float *cx = out.row(0), *cy = out.row(1), *bw = out.row(2), *bh = out.row(3);
+    for (int i = 0; i < num_anchors; i++)
+    {
+        if (best[i] > conf_thres)
+        {
+            float x0 = clampf(cx[i] - 0.5f * bw[i], 0.f, (float)img_w);
+            float y0 = clampf(cy[i] - 0.5f * bh[i], 0.f, (float)img_h);
+            float x1 = clampf(cx[i] + 0.5f * bw[i], 0.f, (float)img_w);
+            float y1 = clampf(cy[i] + 0.5f * bh[i], 0.f, (float)img_h);
+            dets.push(x0, y0, x1, y1, best[i], best_label[i], i);
+        }
+    }
 }
 
-static void parse_yolov11_detections(float *inputs, float conf_thres, int num_channels, int num_anchors, int num_labels, int img_w, int img_h, std::vector<Object> &objects)
+// Prototype x coefficient product for one kept detection, restricted to the
+// box (in letterboxed input coordinates) and evaluated at prototype
+// resolution. Writes mask logits and the input-space rect they cover.
+static void decode_mask(const ncnn::Mat &protos, const float *coeffs, int coeff_step, const cv::Rect_<float> &box, int in_w, cv::Mat &mask, cv::Rect_<float> &mask_rect)
 {
-    std::vector<Object> detections;
-    cv::Mat output(num_channels, num_anchors, CV_32F, inputs);
-    output = output.t();
+    const int pw = protos.w, ph = protos.h, nm = protos.c;
+    const float stride = (float)in_w / pw;
 
-    for (int i = 0; i < num_anchors; i++)
+    int px0 = std::max(0, (int)floorf(box.x / stride));
+    int py0 = std::max(0, (int)floorf(box.y / stride));
+    int px1 = std::min(pw, (int)ceilf((box.x + box.width) / stride));
+    int py1 = std::min(ph, (int)ceilf((box.y + box.height) / stride));
+    if (px1 <= px0 || py1 <= py0)
+    {
+        mask.release();
+        return;
+    }
+
+    mask = cv::Mat::zeros(py1 - py0, px1 - px0, CV_32F);
+    for (int k = 0; k < nm; k++)
     {
-        const float *row = output.ptr<float>(i);
-        const float *bbox = row;
-        const float *cls = row + 4;
-        const float *max_cls = std::max_element(cls, cls + num_labels);
-        float score = *max_cls;
-        if (score > conf_thres)
+        const float c = coeffs[k * coeff_step];
+        const ncnn::Mat proto = protos.channel(k);
+        for (int y = py0; y < py1; y++)
         {
-            float x = bbox[0], y = bbox[1], w = bbox[2], h = bbox[3];
-            float x0 = clampf(x - 0.5f * w, 0.f, (float)img_w);
-            float y0 = clampf(y - 0.5f * h, 0.f, (float)img_h);
-            float x1 = clampf(x + 0.5f * w, 0.f, (float)img_w);
-            float y1 = clampf(y + 0.5f * h, 0.f, (float)img_h);
-
-            Object obj;
-            obj.rect = cv::Rect_<float>(x0, y0, x1 - x0, y1 - y0);
-            obj.label = max_cls - cls;
-            obj.prob = score;
-            detections.push_back(obj);
+            const float *src = proto.row(y) + px0;
+            float *dst = mask.ptr<float>(y - py0);
+            for (int x = 0; x < px1 - px0; x++)
+                dst[x] += c * src[x];
         }
     }
-    objects = detections;
+    mask_rect = cv::Rect_<float>(px0 * stride, py0 * stride, (px1 - px0) * stride, (py1 - py0) * stride);
 }
 
-class YoloV11
+// Keypoints of the kept detections only. The head stores each channel as a
+// row over anchors, so one pass per channel gathers that channel for every
+// kept object, then the letterbox inverse runs as one flat loop over all
+// coordinates.
+static void decode_keypoints(const ncnn::Mat &out, int first, int num_keypoints, float dx, float dy, float scale, int img_w, int img_h, std::vector<Object> &objects)
 {
-private:
-    ncnn::Net net;
-    std::vector<std::string> class_names;
-    std::unique_ptr<ncnn::Extractor> ex;
-    float fconf_thres, fnms_thres;
-
-public:
-    YoloV11(const std::string &model_path, const std::vector<std::string> &names, bool useVulkan = true, bool int8=false, float fconf_thres = 0.25f, float fnms_thres = 0.45f)
+    const int n = objects.size();
+    const int len = num_keypoints * 3;
+    std::vector<float> kpts(n * len);
+    std::vector<int> anchors(n);
+    for (int j = 0; j < n; j++)
+        anchors[j] = objects[j].anchor;
+
+    for (int k = 0; k < len; k++)
     {
-        class_names = names;
-        net.opt.use_vulkan_compute = useVulkan; 
-        printf("[CONFIG] INT8=%d conf=%.2f nms=%.2f\n", int8, fconf_thres, fnms_thres);
-        net.opt.use_bf16_storage = true; 
-        if(int8){
-            net.opt.use_int8_inference = true;
-            net.opt.use_fp16_arithmetic = false;
-        }else{
-            net.opt.use_int8_inference = false;
-            net.opt.use_fp16_arithmetic = true;
-        }      
-        net.opt.use_packing_layout = true;      
-        net.opt.num_threads = 3;
-
-        net.load_param((model_path + ".param").c_str());
-        net.load_model((model_path + ".bin").c_str());
-        this->fconf_thres = fconf_thres;
-        this->fnms_thres = fnms_thres;
+        const float *row = out.row(first + k);
+        for (int j = 0; j < n; j++)
+            kpts[j * len + k] = row[anchors[j]];
     }
 
-    int detect(const cv::Mat &bgr, std::vector<Object> &objects)
+    const float inv = 1.f / scale;
+    for (int i = 0; i < n * num_keypoints; i++)
     {
-        
-        const int target_size = 480;
-        const float conf_thres = fconf_thres;
-        const float nms_thres = fnms_thres;
-        int img_w = bgr.cols, img_h = bgr.rows;
-        int w = img_w, h = img_h;
-        float scale = (w > h) ? (float)target_size / w : (float)target_size / h;
-        w = w * scale;
-        h = h * scale;
-        if (w > h)
-            w = target_size;
-        else
-            h = target_size;
-
-        ncnn::Mat in = ncnn::Mat::from_pixels_resize(bgr.data, ncnn::Mat::PIXEL_BGR2RGB, img_w, img_h, w, h);
-        int wpad = (target_size + MAX_STRIDE - 1) / MAX_STRIDE * MAX_STRIDE - w;
-        int hpad = (target_size + MAX_STRIDE - 1) / MAX_STRIDE * MAX_STRIDE - h;
-        ncnn::Mat in_pad;
-        ncnn::copy_make_border(in, in_pad, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, ncnn::BORDER_CONSTANT, 114.f);
-
-        const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
-        in_pad.substract_mean_normalize(0, norm_vals);
-
-        if (!ex)
-            ex = std::make_unique<ncnn::Extractor>(net.create_extractor());
-
-        auto t0 = std::chrono::high_resolution_clock::now();
-        ex->input("in0", in_pad);
-        ncnn::Mat out;
-        ex->extract("out0", out);
-
-        auto t1 = std::chrono::high_resolution_clock::now();
+        float *kp = &kpts[i * 3];
+        kp[0] = clampf((kp[0] - dx) * inv, 0.f, img_w - 1.f);
+        kp[1] = clampf((kp[1] - dy) * inv, 0.f, img_h - 1.f);
+    }
+
+    for (int j = 0; j < n; j++)
+        objects[j].keypoints.assign(kpts.begin() + j * len, kpts.begin() + (j + 1) * len);
+}
+
+// Oriented boxes: the head emits cx, cy, w, h unrotated plus the angle (in
+// radians) in the last channel.
+static inline cv::RotatedRect anchor_obb(const ncnn::Mat &out, int angle_row, int i)
+{
+    const float theta = out.row(angle_row)[i];
+    return cv::RotatedRect(cv::Point2f(out.row(0)[i], out.row(1)[i]), cv::Size2f(out.row(2)[i], out.row(3)[i]), theta * 180.f / (float)CV_PI);
+}
 
+// Rebuilds each candidate's oriented box from its anchor column and
+// replaces the unrotated bounds in dets with the rotated box's bounds.
+static void decode_obb(const ncnn::Mat &out, int angle_row, int img_w, int img_h, DetectionSet &dets, std::vector<cv::RotatedRect> &obbs)
+{
+    const int n = dets.size();
+    const int *anchor = dets.anchor();
+    float *x0 = dets.x0(), *y0 = dets.y0(), *x1 = dets.x1(), *y1 = dets.y1();
+    obbs.resize(n);
+    for (int j = 0; j < n; j++)
+    {
+        const cv::RotatedRect r = anchor_obb(out, angle_row, anchor[j]);
+        const float theta = r.angle * (float)CV_PI / 180.f;
+        const float cs = fabsf(cosf(theta)), sn = fabsf(sinf(theta));
+        const float ex = 0.5f * (r.size.width * cs + r.size.height * sn);
+        const float ey = 0.5f * (r.size.width * sn + r.size.height * cs);
+        x0[j] = clampf(r.center.x - ex, 0.f, (float)img_w);
+        y0[j] = clampf(r.center.y - ey, 0.f, (float)img_h);
+        x1[j] = clampf(r.center.x + ex, 0.f, (float)img_w);
+        y1[j] = clampf(r.center.y + ey, 0.f, (float)img_h);
+        obbs[j] = r;
+    }
+}
+
+YoloV11::YoloV11(const std::string &model_path, const std::vector<std::string> &names, bool useVulkan, bool int8, float fconf_thres, float fnms_thres, int task)
+    : YoloV11(std::make_unique<NcnnBackend>(model_path, useVulkan, int8), names, fconf_thres, fnms_thres, task)
+{
+}
+
+YoloV11::YoloV11(std::unique_ptr<InferenceBackend> backend, const std::vector<std::string> &names, float fconf_thres, float fnms_thres, int task)
+{
+    this->backend = std::move(backend);
+    class_names = names;
+    this->task = task;
+    this->fconf_thres = fconf_thres;
+    this->fnms_thres = fnms_thres;
+    printf("[CONFIG] %s conf=%.2f nms=%.2f\n", this->backend->describe().c_str(), fconf_thres, fnms_thres);
+}
+
+Letterbox make_letterbox(int img_w, int img_h, float &scale)
+{
+    const int target_size = TARGET_SIZE;
+    int w = img_w, h = img_h;
+    scale = (w > h) ? (float)target_size / w : (float)target_size / h;
+    w = w * scale;
+    h = h * scale;
+    if (w > h)
+        w = target_size;
+    else
+        h = target_size;
+
+    int wpad = (target_size + MAX_STRIDE - 1) / MAX_STRIDE * MAX_STRIDE - w;
+    int hpad = (target_size + MAX_STRIDE - 1) / MAX_STRIDE * MAX_STRIDE - h;
+
+    Letterbox lb;
+    lb.src_w = img_w;
+    lb.src_h = img_h;
+    lb.rw = w;
+    lb.rh = h;
+    lb.pad_left = wpad / 2;
+    lb.pad_top = hpad / 2;
+    lb.w = w + wpad;
+    lb.h = h + hpad;
+    return lb;
+}
+
+ncnn::Mat letterbox_input(const cv::Mat &bgr, const Letterbox &lb, bool fast_resize, int num_threads)
+{
+    ncnn::Mat in = resize_bgr_to_rgb(bgr, lb.rw, lb.rh, fast_resize, num_threads);
+    ncnn::Mat in_pad;
+    ncnn::copy_make_border(in, in_pad, lb.pad_top, lb.h - lb.rh - lb.pad_top, lb.pad_left, lb.w - lb.rw - lb.pad_left, ncnn::BORDER_CONSTANT,
+                           114.f);
+
+    const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
+    in_pad.substract_mean_normalize(0, norm_vals);
+    return in_pad;
+}
+
+int YoloV11::detect(const cv::Mat &bgr, DetectionSet &dets)
+{
+    auto tp = std::chrono::high_resolution_clock::now();
+
+    const float conf_thres = fconf_thres;
+    const float nms_thres = fnms_thres;
+    int img_w = bgr.cols, img_h = bgr.rows;
+    const Letterbox lb = make_letterbox(img_w, img_h, scale);
+    dx = lb.pad_left;
+    dy = lb.pad_top;
+    in_w = lb.w;
+
+    // segmentation heads append one coefficient per prototype channel and
+    // return the prototypes as a second output
+    const int num_outputs = task == TASK_SEGMENT ? 2 : 1;
+
+    // the backend's own letterbox when it has one (Vulkan shader or fused
+    // stem), the CPU chain otherwise (and as fallback); with it, preprocess
+    // time is part of inference
+    int ret = -1;
+    auto t0 = tp;
+    if (backend->accepts_bgr() && (gpu_preprocess || !backend->bgr_on_gpu()))
+        ret = backend->infer_bgr(bgr, lb, outs, num_outputs);
+    if (ret != 0)
+    {
+        ncnn::Mat in_pad = letterbox_input(bgr, lb, fast_resize);
+        t0 = std::chrono::high_resolution_clock::now();
+        ret = backend->infer(in_pad, outs, num_outputs);
+    }
+    if (ret != 0)
+    {
+        fprintf(stderr, "[ERROR] %s inference failed (%d)\n", backend->name(), ret);
+        dets.clear();
+        return ret;
+    }
+    const ncnn::Mat &out = outs[0];
+
+    int num_extra = 0;
+    if (task == TASK_SEGMENT)
+        num_extra = outs[1].c;
+    else if (task == TASK_POSE)
+        num_extra = NUM_KEYPOINTS * 3;
+    else if (task == TASK_OBB)
+        num_extra = 1;
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    if (verbose)
         printf("[INFO] out shape: w=%d, h=%d, c=%d\n", out.w, out.h, out.c);
 
-        std::vector<Object> proposals;
-        parse_yolov11_detections((float *)out.data, conf_thres, out.h, out.w, out.h - 4, in_pad.w, in_pad.h, proposals);
+    num_labels = out.h - 4 - num_extra;
+    parse_yolov11_detections(out, conf_thres, num_labels, lb.w, lb.h, dets, scratch);
+
+    dets.sort_descending();
+    if (task == TASK_OBB)
+    {
+        decode_obb(out, 4 + num_labels, lb.w, lb.h, dets, obbs);
+        nms_sorted_rotated(dets, obbs, scratch, nms_thres);
+    }
+    else
+    {
+        nms_sorted_bboxes(dets, scratch, nms_thres);
+    }
+    dets.select(scratch.picked);
+    dets.remap(dx, dy, scale, img_w, img_h);
 
-        qsort_descent_inplace(proposals);
-        std::vector<int> picked;
-        nms_sorted_bboxes(proposals, picked, nms_thres);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    timing.preprocess_ms = std::chrono::duration<double, std::milli>(t0 - tp).count();
+    timing.inference_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    timing.postprocess_ms = std::chrono::duration<double, std::milli>(t2 - t1).count();
+    timing.task_ms = 0;
+    if (verbose)
+        printf("[TIME] Inference: %.2f ms | Postprocess: %.2f ms\n", timing.inference_ms, timing.postprocess_ms);
+    return 0;
+}
 
-        objects.resize(picked.size());
-        for (size_t i = 0; i < picked.size(); i++)
-        {
-            objects[i] = proposals[picked[i]];
-            float x0 = (objects[i].rect.x - wpad / 2) / scale;
-            float y0 = (objects[i].rect.y - hpad / 2) / scale;
-            float x1 = (objects[i].rect.x + objects[i].rect.width - wpad / 2) / scale;
-            float y1 = (objects[i].rect.y + objects[i].rect.height - hpad / 2) / scale;
-            x0 = clampf(x0, 0.f, img_w - 1.f);
-            y0 = clampf(y0, 0.f, img_h - 1.f);
-            x1 = clampf(x1, 0.f, img_w - 1.f);
-            y1 = clampf(y1, 0.f, img_h - 1.f);
-            objects[i].rect = cv::Rect_<float>(x0, y0, x1 - x0, y1 - y0);
-        }
+int YoloV11::detect(const cv::Mat &bgr, std::vector<Object> &objects)
+{
+    int ret = detect(bgr, detections);
+    if (ret != 0)
+        return ret;
 
-        auto t2 = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double, std::milli> infer_ms = t1 - t0;
-        std::chrono::duration<double, std::milli> post_ms = t2 - t1;
-        printf("[TIME] Inference: %.2f ms | Postprocess: %.2f ms\n", infer_ms.count(), post_ms.count());
+    detections.to_objects(objects);
+    if (task == TASK_DETECT)
         return 0;
-    }
 
-    void save_result(const cv::Mat &bgr, const std::vector<Object> &objects)
+    auto t0 = std::chrono::high_resolution_clock::now();
+    const ncnn::Mat &out = outs[0];
+    for (auto &obj : objects)
     {
-        cv::Mat image = bgr.clone();
-        for (const auto &obj : objects)
+        if (task == TASK_SEGMENT)
+        {
+            // coefficients sit column-wise below the class scores
+            const float *coeffs = out.row(4 + num_labels) + obj.anchor;
+            cv::Rect_<float> box(obj.rect.x * scale + dx, obj.rect.y * scale + dy, obj.rect.width * scale, obj.rect.height * scale);
+            cv::Rect_<float> r;
+            decode_mask(outs[1], coeffs, out.w, box, in_w, obj.mask, r);
+            obj.mask_rect = cv::Rect_<float>((r.x - dx) / scale, (r.y - dy) / scale, r.width / scale, r.height / scale);
+        }
+        else if (task == TASK_OBB)
         {
-            cv::rectangle(image, obj.rect, cv::Scalar(0, 255, 0), 2);
-            char text[128];
-            sprintf(text, "%s %.1f%%", class_names[obj.label].c_str(), obj.prob * 100);
-            cv::putText(image, text, cv::Point(obj.rect.x, obj.rect.y - 5), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0), 1);
+            cv::RotatedRect r = anchor_obb(out, 4 + num_labels, obj.anchor);
+            r.center.x = (r.center.x - dx) / scale;
+            r.center.y = (r.center.y - dy) / scale;
+            r.size.width /= scale;
+            r.size.height /= scale;
+            obj.obb = r;
         }
-        cv::imwrite("output.jpg", image);
-        printf("[INFO] Saved result as output.jpg (%zu objects)\n", objects.size());
     }
-};
+    if (task == TASK_POSE)
+        decode_keypoints(out, 4 + num_labels, NUM_KEYPOINTS, dx, dy, scale, bgr.cols, bgr.rows, objects);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    timing.task_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    if (verbose)
+        printf("[TIME] Task decode: %.2f ms\n", timing.task_ms);
+    return 0;
+}
 
-int main(int argc, char **argv)
+cv::Mat &YoloV11::render_result(cv::Mat &bgr, const std::vector<Object> &objects, int preview_size)
 {
-    if (argc < 3)
-    {
-        printf("Usage: %s [imagepath] [modelpath] [int8=0/1] [conf=0.25] [nms=0.45]\n", argv[0]);
-        return -1;
-    }
+    if (!overlay)
+        overlay = std::make_unique<OverlayRenderer>(class_names);
 
-    std::string image_path = argv[1];
-    std::string model_path = argv[2];
-    bool use_int8 = false;
-    float conf_thres = 0.25f;
-    float nms_thres = 0.45f;
-    if(argc>3) use_int8 = std::stoi(argv[3]);
-    if(argc>4) conf_thres = std::stof(argv[4]);
-    if(argc>5) nms_thres = std::stof(argv[5]);
-
-    cv::Mat img = cv::imread(image_path);
-    if (img.empty())
+    cv::Mat *image = &bgr;
+    float draw_scale = 1.f;
+    if (preview_size > 0 && std::max(bgr.cols, bgr.rows) > preview_size)
     {
-        fprintf(stderr, "Failed to read image: %s\n", image_path.c_str());
-        return -1;
+        draw_scale = (float)preview_size / std::max(bgr.cols, bgr.rows);
+        cv::resize(bgr, preview, cv::Size(), draw_scale, draw_scale, cv::INTER_AREA);
+        image = &preview;
     }
+    overlay->draw(*image, objects, draw_scale);
+    return *image;
+}
 
-    std::vector<std::string> class_names = {
-        "person", "bicycle", "car", "motorcycle", "airplane", "bus", "train", "truck", "boat", "traffic light",
-        "fire hydrant", "stop sign", "parking meter", "bench", "bird", "cat", "dog", "horse", "sheep", "cow",
-        "elephant", "bear", "zebra", "giraffe", "backpack", "umbrella", "handbag", "tie", "suitcase", "frisbee",
-        "skis", "snowboard", "sports ball", "kite", "baseball bat", "baseball glove", "skateboard", "surfboard",
-        "tennis racket", "bottle", "wine glass", "cup", "fork", "knife", "spoon", "bowl", "banana", "apple",
-        "sandwich", "orange", "broccoli", "carrot", "hot dog", "pizza", "donut", "cake", "chair", "couch",
-        "potted plant", "bed", "dining table", "toilet", "tv", "laptop", "mouse", "remote", "keyboard", "cell phone",
-        "microwave", "oven", "toaster", "sink", "refrigerator", "book", "clock", "vase", "scissors", "teddy bear",
-        "hair drier", "toothbrush"};
-
-    YoloV11 yolo(model_path, class_names, true, use_int8, conf_thres, nms_thres);
-    std::vector<Object> objects;
-    yolo.detect(img, objects);
-    yolo.save_result(img, objects);
-    return 0;
+void YoloV11::save_result(cv::Mat &bgr, const std::vector<Object> &objects, int preview_size)
+{
+    cv::imwrite("output.jpg", render_result(bgr, objects, preview_size));
+    printf("[INFO] Saved result as output.jpg (%zu objects)\n", objects.size());
 }
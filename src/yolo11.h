@@ -0,0 +1,105 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "net.h"
+#include "backend.h"
+#include "detection_set.h"
+#include "object.h"
+#include "overlay.h"
+
+#define MAX_STRIDE 32
+#define TARGET_SIZE 480 // longer side of the letterboxed input
+#define NUM_KEYPOINTS 17
+
+enum YoloTask
+{
+    TASK_DETECT = 0,
+    TASK_SEGMENT = 1,
+    TASK_POSE = 2,
+    TASK_OBB = 3
+};
+
+// per-stage wall time of the last detect()
+struct DetectTiming
+{
+    double preprocess_ms = 0;
+    double inference_ms = 0;
+    double postprocess_ms = 0;
+    double task_ms = 0; // masks / keypoints / oriented boxes
+};
+
+// Letterbox geometry of an img_w x img_h frame: the longer side scaled to
+// TARGET_SIZE (scale is that factor), then padded to a MAX_STRIDE multiple.
+Letterbox make_letterbox(int img_w, int img_h, float &scale);
+// The CPU preprocessing of detect() for lb: resize, BGR->RGB, 114 padding
+// and 1/255 scaling into the network's float input, on num_threads threads.
+ncnn::Mat letterbox_input(const cv::Mat &bgr, const Letterbox &lb, bool fast_resize = true, int num_threads = 3);
+
+// Per-anchor and NMS buffers of the postprocess. Like DetectionSet they are
+// sized once for one slot per head anchor and reused frame after frame.
+struct PostprocessScratch
+{
+    std::vector<float> best;     // best class score per anchor
+    std::vector<int> best_label; // ... and its label
+    std::vector<float> kx0, ky0, kx1, ky1, karea; // boxes kept by NMS so far
+    std::vector<int> klabel;
+    std::vector<float> covs; // oriented box covariances, 3 per detection
+    std::vector<int> picked;
+
+    // grows storage to at least capacity, never shrinks
+    void reserve(int capacity);
+};
+
+class YoloV11
+{
+private:
+    std::unique_ptr<InferenceBackend> backend;
+    std::vector<std::string> class_names;
+    float fconf_thres, fnms_thres;
+    int task;
+
+    // state of the last detect(), reused by the task-specific decoders
+    std::vector<ncnn::Mat> outs;
+    int num_labels = 0;
+    float scale = 1.f;
+    int dx = 0, dy = 0, in_w = 0;
+    DetectionSet detections;
+    PostprocessScratch scratch;
+    std::vector<cv::RotatedRect> obbs;
+    DetectTiming timing;
+
+    std::unique_ptr<OverlayRenderer> overlay;
+    cv::Mat preview;
+
+public:
+    // prints per-frame shapes and timings when set
+    bool verbose = true;
+    // let the backend letterbox on its GPU when it can (Vulkan); the CPU
+    // fused stem backend reads the frame regardless
+    bool gpu_preprocess = true;
+    // box-filter integer-ratio frames on the CPU path (see downscale.h)
+    bool fast_resize = true;
+
+    YoloV11(const std::string &model_path, const std::vector<std::string> &names, bool useVulkan = true, bool int8=false, float fconf_thres = 0.25f, float fnms_thres = 0.45f, int task = TASK_DETECT);
+    YoloV11(std::unique_ptr<InferenceBackend> backend, const std::vector<std::string> &names, float fconf_thres = 0.25f, float fnms_thres = 0.45f, int task = TASK_DETECT);
+
+    // Boxes only, kept in structure-of-arrays form end to end. dets stays
+    // valid until the next call.
+    int detect(const cv::Mat &bgr, DetectionSet &dets);
+    int detect(const cv::Mat &bgr, std::vector<Object> &objects);
+
+    // Annotates bgr in place. With preview_size > 0 the frame is first
+    // downscaled so its longer side is preview_size and drawn at that size.
+    // Returns the annotated image (bgr or the reused preview buffer).
+    cv::Mat &render_result(cv::Mat &bgr, const std::vector<Object> &objects, int preview_size = 0);
+    // render_result() written to output.jpg
+    void save_result(cv::Mat &bgr, const std::vector<Object> &objects, int preview_size = 0);
+
+    const DetectTiming &last_timing() const { return timing; }
+    const char *backend_name() const { return backend->name(); }
+    std::string backend_config() const { return backend->describe(); }
+    const std::vector<std::string> &names() const { return class_names; }
+};